@@ -1,8 +1,11 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <intrinsic.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -18,41 +21,111 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency. */
+#define PIT_HZ 1193180
+
+/* 8254 input clocks per timer tick, rounded to nearest. */
+#define PIT_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Number of ticks the clocks are calibrated over.  The 8254's
+   16-bit counter limits this to 5. */
+#define CALIBRATE_TICKS 5
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If true, stop the periodic tick while idle.
+   Controlled by kernel command-line option "-o tickless". */
+bool timer_tickless;
+
+/* Timer hardware: the local APIC timer if the APIC is in use,
+   otherwise counter 0 of the 8254.  Counts are in units of the
+   hardware's input clock. */
+static uint32_t tick_count;             /* Input clocks per tick. */
+static int64_t oneshot_max_ticks;       /* Most ticks one count covers. */
+
+/* Tickless idle state.  While ONESHOT_TICKS is nonzero, the timer
+   is in one-shot mode and its next interrupt ends tick number
+   TICKS + ONESHOT_TICKS.  ONESHOT_COUNT is the count that was
+   loaded, and ONESHOT_BASE is how many input clocks of the
+   current tick had already gone by when it was loaded. */
+static int64_t oneshot_ticks;
+static uint32_t oneshot_count;
+static int64_t oneshot_base;
+
+/* Clocksource.  If the CPU has a time-stamp counter, timer_now_ns()
+   is (rdtsc () - TSC_BASE) * TSC_MULT / 2**32; otherwise it only
+   advances once per tick.  Pintos never changes the CPU's clock
+   frequency, so a TSC that CPUID does not advertise as invariant
+   still runs at a constant rate. */
+static bool tsc_enabled;
+static uint64_t tsc_base;               /* TSC at calibration. */
+static uint64_t tsc_mult;               /* 2**32 ns per TSC clock. */
+
+/* Armed high-resolution timers, soonest deadline first.  With
+   the APIC, the local APIC timer provides the tick and the 8254
+   is free to interrupt once at the first deadline, so
+   HRTIMER_ONESHOT is true; otherwise hrtimers expire on the
+   first tick after their deadline. */
+static struct list hrtimers;
+static bool hrtimer_oneshot;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static intr_handler_func hrtimer_interrupt;
+static void hrtimer_expire (void);
+static void hrtimer_program (void);
+static hrtimer_func hrtimer_wake;
+static void hrtimer_sleep (uint64_t ns);
+static void clock_periodic (void);
+static void clock_oneshot (uint32_t count);
+static uint32_t clock_read (bool *expired);
+static bool clock_pending (void);
+static void clock_calibrate (void);
+static void pit_periodic (void);
+static void pit_oneshot (uint16_t count);
+static uint16_t pit_read (bool *out);
+static void oneshot_interrupt (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
-void thread_sleep(int64_t ticks);
-void thread_wakeup(int64_t ticks);
-
-struct list ready_list;
-
-struct list ready_list;
-struct list sleep_list; 
 
-int READY_THREADS;
-int LOAD_AVG;
-/* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+/* Sets up the timer to interrupt TIMER_FREQ times per second,
+   and registers the corresponding interrupt.  With the APIC, the
+   local APIC timer is used, calibrated against the 8254 Programmable
+   Interval Timer (PIT), and the PIT is left to high-resolution
+   timers; otherwise the PIT itself. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	list_init (&hrtimers);
+	clock_calibrate ();
+	if (apic_enabled)
+		oneshot_max_ticks = UINT32_MAX / tick_count;
+	else {
+		tick_count = PIT_COUNT;
+		oneshot_max_ticks = UINT16_MAX / tick_count;
+	}
+	clock_periodic ();
+
+	intr_register_ext (0x20, timer_interrupt,
+			apic_enabled ? "APIC Timer" : "8254 Timer");
+	if (apic_enabled) {
+		/* The 8254 is wired to I/O APIC input 2. */
+		intr_register_ext (0x22, hrtimer_interrupt, "8254 One-shot");
+		hrtimer_oneshot = true;
+	}
+}
 
-	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+/* Starts the tick on an application processor, from its own local
+   APIC timer at the rate timer_init() calibrated.  Only the
+   bootstrap processor's tick keeps time; see timer_interrupt(). */
+void
+timer_init_ap (void) {
+	ASSERT (apic_enabled);
+	lapic_timer_periodic (0x20, tick_count);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -97,6 +170,15 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the timer was
+   calibrated at boot. */
+uint64_t
+timer_now_ns (void) {
+	if (!tsc_enabled)
+		return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+	return ((unsigned __int128) (rdtsc () - tsc_base) * tsc_mult) >> 32;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
@@ -134,82 +216,373 @@ timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts.  In tickless mode, replaces the
+   periodic tick by a single interrupt at the end of the tick at
+   which the next sleeper is due, or as close to it as the
+   counter allows. */
 void
-update_recent_cpu(void){
-	struct list_elem *e;
-	struct thread *thrd;
-	int decay_factor = div_x_by_y(mul_x_by_n(LOAD_AVG,2),add_x_and_n(mul_x_by_n(LOAD_AVG,2), 1));
-	// RUNNING THREAD도 업데이트 해야함
-	thread_current()->recent_cpu = add_x_and_n(mul_x_by_y(decay_factor,thread_current()->recent_cpu),thread_current()->nice);
-
-	for (e = list_begin (&ready_list); e != list_end (&ready_list); e = list_next (e)){
-		thrd = list_entry(e,struct thread,elem);
-		thrd->recent_cpu = add_x_and_n(mul_x_by_y(decay_factor,thrd->recent_cpu),thrd->nice);
-	}
-	for (e=list_begin(&sleep_list); e != list_end(&sleep_list); e = list_next(e)){
-		thrd = list_entry(e,struct thread,elem);
-		thrd->recent_cpu = add_x_and_n(mul_x_by_y(decay_factor,thrd->recent_cpu),thrd->nice);
+timer_idle_enter (void) {
+	int64_t skip;
+	uint32_t remaining;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* The tickless state is the bootstrap processor's.  The others
+	   keep ticking. */
+	if (!timer_tickless || oneshot_ticks != 0 || cpu_current ()->id != 0)
+		return;
+
+	skip = thread_next_wakeup () - ticks;
+	if (skip > oneshot_max_ticks)
+		skip = oneshot_max_ticks;
+
+	/* The MLFQS recomputes load_avg and recent_cpu on every
+	   second boundary, so that tick must really happen. */
+	if (thread_mlfqs && skip > TIMER_FREQ - ticks % TIMER_FREQ)
+		skip = TIMER_FREQ - ticks % TIMER_FREQ;
+	if (skip < 2)
+		return;
+
+	/* If a tick ended before we got here, it has to be delivered
+	   as a plain tick first. */
+	remaining = clock_read (NULL);
+	if (clock_pending ())
+		return;
+
+	oneshot_ticks = skip;
+	oneshot_base = tick_count - remaining;
+	oneshot_count = skip * tick_count - oneshot_base;
+	clock_oneshot (oneshot_count);
+}
+
+/* Called by the scheduler, with interrupts off, when it switches
+   away from the idle thread.  If the periodic tick is stopped,
+   catches up on the ticks that went by and arms the timer to
+   fire at the end of the current tick, at which point the timer
+   interrupt resumes periodic mode. */
+void
+timer_idle_exit (void) {
+	int64_t skipped, elapsed;
+	bool expired;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (oneshot_ticks == 0 || cpu_current ()->id != 0)
+		return;
+
+	elapsed = oneshot_base + (oneshot_count - clock_read (&expired));
+	if (expired) {
+		/* The interrupt is pending and will catch up itself. */
+		return;
 	}
+
+	/* Every sleeper is due after the one-shot count expires, so
+	   none of the skipped ticks has anyone to wake up. */
+	skipped = elapsed / tick_count;
+	ASSERT (skipped < oneshot_ticks);
+	ticks += skipped;
+	thread_tick_idle (skipped);
+
+	oneshot_ticks = 1;
+	oneshot_base = 0;
+	oneshot_count = tick_count - elapsed % tick_count;
+	clock_oneshot (oneshot_count);
 }
 
+/* Initializes TIMER to call FUNC, with AUX stored in TIMER for
+   FUNC's use, once it has been started and its deadline passes. */
+void
+hrtimer_init (struct hrtimer *timer, hrtimer_func *func, void *aux) {
+	ASSERT (timer != NULL);
+	ASSERT (func != NULL);
+
+	timer->deadline = 0;
+	timer->func = func;
+	timer->aux = aux;
+	timer->armed = false;
+}
 
+/* Arms TIMER to expire at DEADLINE, in timer_now_ns() units.
+   TIMER's function is always called from the interrupt handler,
+   even if DEADLINE has already passed. */
 void
-recompute_priority(void){
+hrtimer_start (struct hrtimer *timer, uint64_t deadline) {
+	enum intr_level old_level;
 	struct list_elem *e;
-	struct thread *thrd;
-	thread_current()->priority = convert_x_to_int_round_to_nearest(sub_n_from_x(sub_y_from_x(convert_n_to_fp(PRI_MAX),(div_x_by_n(thread_current()->recent_cpu,4))),(2 * thread_current()->nice)));
-	for (e = list_begin (&ready_list); e != list_end (&ready_list); e = list_next (e)){
-		thrd = list_entry(e,struct thread,elem);
-		thrd->priority = convert_x_to_int_round_to_nearest(sub_n_from_x(sub_y_from_x(convert_n_to_fp(PRI_MAX),(div_x_by_n(thrd->recent_cpu,4))),(2 * thrd->nice)));
-		if (PRI_MAX < thrd->priority) thrd->priority = PRI_MAX;
-		else if (PRI_MIN > thrd->priority) thrd->priority = PRI_MIN;
-	}
-	for (e=list_begin(&sleep_list); e != list_end(&sleep_list); e = list_next(e)){
-		thrd = list_entry(e,struct thread,elem);
-		// recent_cpu를 fp로 바꿀까?
-		thrd->priority = convert_x_to_int_round_to_nearest(sub_n_from_x(sub_y_from_x(convert_n_to_fp(PRI_MAX),(div_x_by_n(thrd->recent_cpu,4))),(2 * thrd->nice)));
-		if (PRI_MAX < thrd->priority) thrd->priority = PRI_MAX;
-		else if (PRI_MIN > thrd->priority) thrd->priority = PRI_MIN;
+
+	old_level = intr_disable ();
+	if (timer->armed)
+		list_remove (&timer->elem);
+	timer->deadline = deadline;
+	timer->armed = true;
+
+	for (e = list_begin (&hrtimers); e != list_end (&hrtimers);
+			e = list_next (e))
+		if (list_entry (e, struct hrtimer, elem)->deadline > deadline)
+			break;
+	list_insert (e, &timer->elem);
+	if (list_front (&hrtimers) == &timer->elem)
+		hrtimer_program ();
+	intr_set_level (old_level);
+}
+
+/* Disarms TIMER.  Returns true if it was armed, false if it had
+   already expired or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *timer) {
+	enum intr_level old_level;
+	bool armed;
+
+	old_level = intr_disable ();
+	armed = timer->armed;
+	if (armed) {
+		/* If TIMER was first, the 8254 interrupts for nothing. */
+		list_remove (&timer->elem);
+		timer->armed = false;
 	}
+	intr_set_level (old_level);
+	return armed;
 }
-/* Timer interrupt handler. */
+
+/* Timer interrupt handler.  Every CPU's tick preempts and
+   accounts its own threads, but only the bootstrap processor's
+   counts TICKS and runs the timers. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	struct cpu *c = cpu_current ();
+
+	c->local_ticks++;
+	if (c->id != 0) {
+		thread_tick ();
+		if (thread_mlfqs)
+			thread_mlfqs_tick (c->local_ticks);
+		return;
+	}
+
+	if (oneshot_ticks != 0)
+		oneshot_interrupt ();
 	ticks++;
 	thread_tick ();
 	thread_wakeup(ticks);
+	if (!hrtimer_oneshot)
+		hrtimer_expire ();
 	/* check sleep list and the global tick.
 	   find any threads to wake up,
 	   move them to the ready list if necessary.
 	   update the global tick.
 	*/
-	if(thread_mlfqs){
-	enum intr_level old_level = intr_disable ();
-	if(thread_current != idle_thread) thread_current()->recent_cpu += 16384; // for every tick 
+	if (thread_mlfqs)
+		thread_mlfqs_tick (ticks);
+}
 
-	if( timer_ticks() % TIMER_FREQ == 0 ) { // 1초 마다
-		// update everty thread's recent_cpu  
-	
-	
-		int decayed_load_avg = div_x_by_n(mul_x_by_n(LOAD_AVG,59),60);
-		READY_THREADS = list_size(&ready_list);
-		if(thread_current() != idle_thread)  // idle이 아니라면, +1 , 맞으면 그냥 
-			READY_THREADS += 1;
+/* Handles a timer interrupt that arrives while a one-shot count
+   is armed.  If the count expired, catches TICKS up on the ticks
+   it covered, except for the one timer_interrupt() itself is
+   about to count, and resumes the periodic tick. */
+static void
+oneshot_interrupt (void) {
+	bool expired;
+
+	clock_read (&expired);
+	if (!expired) {
+		/* A periodic tick that ended between timer_idle_enter()'s
+		   check and the count being loaded.  It is one of the
+		   ticks the one-shot count covers. */
+		oneshot_ticks--;
+		oneshot_base -= tick_count;
+		return;
+	}
 
-		int fp_ready_thread = convert_n_to_fp(READY_THREADS);
-		int decayed_ready_threads = div_x_by_n(fp_ready_thread,60);
-		LOAD_AVG = add_x_and_y(decayed_load_avg,decayed_ready_threads); // update load average in every sec
+	clock_periodic ();
+	ticks += oneshot_ticks - 1;
+	thread_tick_idle (oneshot_ticks - 1);
+	oneshot_ticks = 0;
+}
 
-		update_recent_cpu();
-	}
-	if ( timer_ticks() % 4 == 0){ // 4틱 마다
-		recompute_priority();
-		// recompute the priority of all threads
+/* 8254 one-shot interrupt handler. */
+static void
+hrtimer_interrupt (struct intr_frame *args UNUSED) {
+	hrtimer_expire ();
+	hrtimer_program ();
+}
+
+/* Calls the function of each hrtimer whose deadline has passed. */
+static void
+hrtimer_expire (void) {
+	uint64_t now = timer_now_ns ();
+
+	ASSERT (intr_context ());
+
+	while (!list_empty (&hrtimers)) {
+		struct hrtimer *timer = list_entry (list_front (&hrtimers),
+				struct hrtimer, elem);
+		if (timer->deadline > now)
+			break;
+		list_pop_front (&hrtimers);
+		timer->armed = false;
+		timer->func (timer);
 	}
+}
+
+/* Programs the 8254 to interrupt at the first hrtimer's deadline,
+   or as close to it as the counter allows.  Interrupts must be
+   off. */
+static void
+hrtimer_program (void) {
+	uint64_t now, delta, count;
+
+	if (!hrtimer_oneshot || list_empty (&hrtimers))
+		return;
+
+	now = timer_now_ns ();
+	delta = list_entry (list_front (&hrtimers), struct hrtimer,
+			elem)->deadline;
+	delta = delta > now ? delta - now : 0;
+	if (delta > NSEC_PER_SEC)
+		delta = NSEC_PER_SEC;
+
+	/* Round up, so that the interrupt never comes early. */
+	count = (delta * PIT_HZ + NSEC_PER_SEC - 1) / NSEC_PER_SEC;
+	if (count == 0)
+		count = 1;
+	else if (count > UINT16_MAX)
+		count = UINT16_MAX;
+	pit_oneshot (count);
+}
+
+/* Unblocks the thread that armed TIMER in hrtimer_sleep(). */
+static void
+hrtimer_wake (struct hrtimer *timer) {
+	struct thread *t = timer->aux;
+
+	thread_unblock (t);
+	thread_test_preemption ();
+}
+
+/* Blocks the running thread for NS nanoseconds, using an hrtimer. */
+static void
+hrtimer_sleep (uint64_t ns) {
+	struct hrtimer timer;
+	enum intr_level old_level;
+
+	hrtimer_init (&timer, hrtimer_wake, thread_current ());
+	old_level = intr_disable ();
+	hrtimer_start (&timer, timer_now_ns () + ns);
+	thread_block ();
 	intr_set_level (old_level);
+}
+
+/* Programs the timer to interrupt once per tick. */
+static void
+clock_periodic (void) {
+	if (apic_enabled)
+		lapic_timer_periodic (0x20, tick_count);
+	else
+		pit_periodic ();
+}
+
+/* Programs the timer to interrupt once, COUNT input clocks from
+   now. */
+static void
+clock_oneshot (uint32_t count) {
+	if (apic_enabled)
+		lapic_timer_oneshot (0x20, count);
+	else
+		pit_oneshot (count);
+}
+
+/* Returns the timer's current count.  If EXPIRED is nonnull,
+   stores in it whether a one-shot count has expired. */
+static uint32_t
+clock_read (bool *expired) {
+	uint32_t count;
+
+	if (apic_enabled) {
+		count = lapic_timer_current ();
+		if (expired != NULL)
+			*expired = count == 0;
+	} else
+		count = pit_read (expired);
+	return count;
+}
+
+/* Returns true if a timer interrupt is waiting to be delivered. */
+static bool
+clock_pending (void) {
+	if (apic_enabled)
+		return apic_pending (0x20);
+	outb (0x20, 0x0a);    /* OCW3: read master PIC's IRR. */
+	return inb (0x20) & 1;
+}
+
+/* Measures the rate of the TSC, and with the APIC the number of
+   local APIC timer clocks in one tick, by letting the PIT count
+   down CALIBRATE_TICKS ticks' worth of its own clocks.
+   Interrupts must be off. */
+static void
+clock_calibrate (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t tsc_start, tsc_hz;
+	bool expired;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	tsc_enabled = (edx & (1 << 4)) != 0;
+
+	pit_oneshot (CALIBRATE_TICKS * PIT_COUNT);
+	if (apic_enabled)
+		lapic_timer_oneshot (0x20, UINT32_MAX);
+	tsc_start = tsc_enabled ? rdtsc () : 0;
+	do
+		pit_read (&expired);
+	while (!expired);
+
+	if (apic_enabled)
+		tick_count = (UINT32_MAX - lapic_timer_current ()) / CALIBRATE_TICKS;
+	if (tsc_enabled) {
+		tsc_base = rdtsc ();
+		tsc_hz = (tsc_base - tsc_start) * PIT_HZ
+			/ (CALIBRATE_TICKS * PIT_COUNT);
+		tsc_mult = ((uint64_t) NSEC_PER_SEC << 32) / tsc_hz;
 	}
 }
 
+/* Programs counter 0 to interrupt every PIT_COUNT input clocks,
+   that is, TIMER_FREQ times per second. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, PIT_COUNT & 0xff);
+	outb (0x40, PIT_COUNT >> 8);
+}
+
+/* Programs counter 0 to interrupt once, COUNT input clocks from
+   now. */
+static void
+pit_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns counter 0's current count.  If OUT is nonnull, stores
+   in it whether the counter's output is high, which in mode 0
+   means that the count has expired. */
+static uint16_t
+pit_read (bool *out) {
+	uint8_t status, lo, hi;
+
+	outb (0x43, 0xc2);    /* Read-back: latch count and status of counter 0. */
+	status = inb (0x40);
+	lo = inb (0x40);
+	hi = inb (0x40);
+	if (out != NULL)
+		*out = (status & 0x80) != 0;
+	return lo | (hi << 8);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -253,7 +626,13 @@ real_time_sleep (int64_t num, int32_t denom) {
 	int64_t ticks = num * TIMER_FREQ / denom;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
+	if (hrtimer_oneshot) {
+		/* Block until the 8254 says the time is up.  DENOM divides
+		   NSEC_PER_SEC exactly. */
+		ASSERT (NSEC_PER_SEC % denom == 0);
+		if (num > 0)
+			hrtimer_sleep (num * (NSEC_PER_SEC / denom));
+	} else if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
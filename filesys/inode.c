@@ -5,7 +5,11 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -29,8 +33,9 @@ bytes_to_sectors (off_t size) {
 /* In-memory inode. */
 struct inode {
 	struct list_elem elem;              /* Element in inode list. */
+	struct rcu_head rcu;                /* Frees it once unreachable. */
 	disk_sector_t sector;               /* Sector number of disk location. */
-	int open_cnt;                       /* Number of openers. */
+	int open_cnt;                       /* Number of openers (intr off). */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
@@ -50,13 +55,51 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Readers walk it under RCU;
+ * OPEN_INODES_LOCK serializes the changes. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/* Cache of `struct inode's. */
+static struct kmem_cache *inode_cache;
+
+static rcu_func inode_free;
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
+	if (inode_cache == NULL)
+		PANIC ("cannot create inode cache");
+}
+
+/* Looks for the open inode at SECTOR and opens it again.  Returns
+ * the inode, or a null pointer if there is none.  An inode whose
+ * last opener is closing it does not count. */
+static struct inode *
+inode_lookup (disk_sector_t sector) {
+	struct list_elem *e;
+	struct inode *found = NULL;
+
+	rcu_read_lock ();
+	for (e = list_begin_rcu (&open_inodes); e != list_end (&open_inodes);
+			e = list_next_rcu (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector) {
+			enum intr_level old_level = intr_disable ();
+			if (inode->open_cnt > 0) {
+				inode->open_cnt++;
+				found = inode;
+			}
+			intr_set_level (old_level);
+			if (found != NULL)
+				break;
+		}
+	}
+	rcu_read_unlock ();
+	return found;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -101,39 +144,46 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct inode *inode, *found;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
-	}
+	inode = inode_lookup (sector);
+	if (inode != NULL)
+		return inode;
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = kmem_cache_alloc (inode_cache);
 	if (inode == NULL)
 		return NULL;
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  It must be complete before readers can see it. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
+
+	/* Someone else may have opened it while we read the disk. */
+	lock_acquire (&open_inodes_lock);
+	found = inode_lookup (sector);
+	if (found == NULL)
+		list_push_front_rcu (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+	if (found != NULL) {
+		kmem_cache_free (inode_cache, inode);
+		inode = found;
+	}
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		enum intr_level old_level = intr_disable ();
 		inode->open_cnt++;
+		intr_set_level (old_level);
+	}
 	return inode;
 }
 
@@ -148,14 +198,24 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	enum intr_level old_level;
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
+	old_level = intr_disable ();
+	last = --inode->open_cnt == 0;
+	intr_set_level (old_level);
+
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+	if (last) {
+		/* Remove from inode list; lookups may still be looking at
+		 * it until a grace period has passed. */
+		lock_acquire (&open_inodes_lock);
+		list_remove_rcu (&inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -164,10 +224,16 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		call_rcu (&inode->rcu, inode_free);
 	}
 }
 
+/* Frees the inode whose RCU head is HEAD. */
+static void
+inode_free (struct rcu_head *head) {
+	kmem_cache_free (inode_cache, rcu_entry (head, struct inode, rcu));
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
  * has it open. */
 void
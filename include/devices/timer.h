@@ -1,17 +1,24 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000LL
+
 void timer_init (void);
+void timer_init_ap (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_now_ns (void);
 
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -20,4 +27,31 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the idle thread stops the periodic tick and programs
+   the timer to fire at the next sleeper's deadline instead.
+   Controlled by kernel command-line option "-o tickless". */
+extern bool timer_tickless;
+
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/* A high-resolution timer, which calls FUNC from the interrupt
+   handler once timer_now_ns() reaches DEADLINE. */
+struct hrtimer;
+typedef void hrtimer_func (struct hrtimer *);
+
+struct hrtimer {
+	struct list_elem elem;      /* List element, for the armed timers. */
+	uint64_t deadline;          /* Expiry time, in timer_now_ns() units. */
+	hrtimer_func *func;         /* Called when the deadline passes. */
+	void *aux;                  /* Free for FUNC's use. */
+	bool armed;                 /* On the armed timers list? */
+};
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, uint64_t deadline);
+bool hrtimer_cancel (struct hrtimer *);
+
 #endif /* devices/timer.h */
@@ -141,6 +141,19 @@ bool list_empty (struct list *);
 /* Miscellaneous. */
 void list_reverse (struct list *);
 
+/* Read-copy-update.  Readers in an RCU read-side critical section
+   (see threads/rcu.h) may walk a list forward with these, without
+   a lock, while one writer at a time, excluded from the others by
+   some lock, changes it with the _rcu insertions and removals.  A
+   removed element may still be in use by readers until a grace
+   period has passed. */
+struct list_elem *list_begin_rcu (struct list *);
+struct list_elem *list_next_rcu (struct list_elem *);
+void list_insert_rcu (struct list_elem *, struct list_elem *);
+void list_push_front_rcu (struct list *, struct list_elem *);
+void list_push_back_rcu (struct list *, struct list_elem *);
+void list_remove_rcu (struct list_elem *);
+
 /* Compares the value of two list elements A and B, given
    auxiliary data AUX.  Returns true if A is less than B, or
    false if A is greater than or equal to B. */
@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_PQUEUE_H
+#define __LIB_KERNEL_PQUEUE_H
+
+/* Priority queue.
+ *
+ * This is a pairing heap: a tree in which every element is
+ * greater than or equal to its children, kept as a leftmost
+ * child pointer plus a doubly linked list of siblings in every
+ * node.  Pushing an element takes O(1) time; popping the
+ * greatest element, removing an arbitrary one and moving one
+ * whose key changed take O(log n) amortized time.
+ *
+ * Like lists and hash tables, priority queues do not use dynamic
+ * allocation.  Each structure that can be in a priority queue
+ * must embed a struct pq_elem member, and pq_entry() converts a
+ * struct pq_elem back to the structure that contains it.  See
+ * lib/kernel/list.h for a detailed explanation of the technique.
+ *
+ * Elements that compare equal come out in the order in which
+ * they were pushed, so a queue of equal-priority threads is
+ * first-in, first-out.  An element's key may change while it is
+ * in a queue, as long as pq_update() is called afterward. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Priority queue element. */
+struct pq_elem {
+	struct pq_elem *child;      /* Leftmost child. */
+	struct pq_elem *next;       /* Next sibling. */
+	struct pq_elem *prev;       /* Previous sibling, or the parent
+	                               of a leftmost child. */
+	uint64_t seq;               /* Push order, for breaking ties. */
+};
+
+/* Converts pointer to priority queue element PQ_ELEM into a
+ * pointer to the structure that PQ_ELEM is embedded inside.
+ * Supply the name of the outer structure STRUCT and the member
+ * name MEMBER of the priority queue element. */
+#define pq_entry(PQ_ELEM, STRUCT, MEMBER)                       \
+	((STRUCT *) ((uint8_t *) &(PQ_ELEM)->child              \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two priority queue elements A and B,
+ * given auxiliary data AUX.  Returns true if A is less than B,
+ * or false if A is greater than or equal to B. */
+typedef bool pq_less_func (const struct pq_elem *a,
+		const struct pq_elem *b, void *aux);
+
+/* Priority queue. */
+struct pqueue {
+	struct pq_elem *root;       /* Greatest element, or NULL. */
+	size_t elem_cnt;            /* Number of elements. */
+	uint64_t seq;               /* Next push order. */
+	pq_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void pq_init (struct pqueue *, pq_less_func *, void *aux);
+
+size_t pq_size (const struct pqueue *);
+bool pq_empty (const struct pqueue *);
+
+void pq_push (struct pqueue *, struct pq_elem *);
+struct pq_elem *pq_max (const struct pqueue *);
+struct pq_elem *pq_pop (struct pqueue *);
+void pq_remove (struct pqueue *, struct pq_elem *);
+
+void pq_update (struct pqueue *, struct pq_elem *);
+
+#endif /* lib/kernel/pqueue.h */
@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * This is a binary search tree in which every node is colored
+ * red or black, no red node has a red child, and every path from
+ * the root to a leaf passes through the same number of black
+ * nodes, so that its height stays within 2 lg(n + 1).  Inserting
+ * and removing an element take O(log n) time.  The least element
+ * is cached, so finding it takes O(1) time.
+ *
+ * Like lists and hash tables, red-black trees do not use dynamic
+ * allocation.  Each structure that can be in a tree must embed a
+ * struct rb_node member, and rb_entry() converts a struct rb_node
+ * back to the structure that contains it.  See lib/kernel/list.h
+ * for a detailed explanation of the technique.
+ *
+ * Elements that compare equal are kept in the order in which
+ * they were inserted, so taking the least element repeatedly
+ * from a tree of equal elements is first-in, first-out.  An
+ * element's key must not change while it is in a tree; remove
+ * it, change it, and insert it again instead. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree node. */
+struct rb_node {
+	struct rb_node *parent;     /* Parent, or NULL for the root. */
+	struct rb_node *left;       /* Lesser child. */
+	struct rb_node *right;      /* Greater or equal child. */
+	bool red;                   /* Red if true, black if false. */
+};
+
+/* Converts pointer to red-black tree node RB_NODE into a pointer
+ * to the structure that RB_NODE is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the red-black tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)                       \
+	((STRUCT *) ((uint8_t *) &(RB_NODE)->parent             \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two red-black tree nodes A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or false
+ * if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+		const struct rb_node *b, void *aux);
+
+/* Red-black tree. */
+struct rb_tree {
+	struct rb_node *root;       /* Root, or NULL if empty. */
+	struct rb_node *min;        /* Least node, or NULL if empty. */
+	size_t elem_cnt;            /* Number of nodes. */
+	rb_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+void rb_insert (struct rb_tree *, struct rb_node *);
+void rb_remove (struct rb_tree *, struct rb_node *);
+struct rb_node *rb_min (const struct rb_tree *);
+struct rb_node *rb_pop_min (struct rb_tree *);
+
+struct rb_node *rb_next (struct rb_node *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,22 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage, as reported by the getrusage system call.
+   Times are in nanoseconds. */
+struct rusage {
+	uint64_t utime;             /* Time spent in user mode. */
+	uint64_t stime;             /* Time spent in the kernel. */
+	uint64_t nvcsw;             /* Switches away while blocking. */
+	uint64_t nivcsw;            /* Switches away while still ready. */
+	uint64_t faults;            /* Page faults. */
+	uint64_t inblock;           /* Disk sectors read. */
+	uint64_t oublock;           /* Disk sectors written. */
+};
+
+/* Whose usage getrusage() reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that have exited. */
+
+#endif /* lib/rusage.h */
@@ -36,6 +36,9 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Accounting. */
+	SYS_GETRUSAGE,              /* Report resource usage. */
 };
 
 #endif /* lib/syscall-nr.h */
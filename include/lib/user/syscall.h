@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -38,6 +39,8 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+int getrusage (int who, struct rusage *usage);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
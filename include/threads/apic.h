@@ -0,0 +1,32 @@
+#ifndef THREADS_APIC_H
+#define THREADS_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Vector for spurious local APIC interrupts. */
+#define APIC_SPURIOUS_VEC 0xff
+
+/* True if interrupts are delivered through the local APIC and
+   I/O APIC, false if through the 8259A PICs. */
+extern bool apic_enabled;
+
+bool apic_init (void);
+void apic_init_ap (void);
+unsigned apic_id (void);
+void apic_eoi (void);
+void apic_route_irq (int irq, uint8_t vec_no);
+bool apic_pending (uint8_t vec_no);
+
+/* Interprocessor interrupts. */
+void apic_send_ipi (unsigned apic_id, uint8_t vec_no);
+void apic_send_init (unsigned apic_id);
+void apic_send_startup (unsigned apic_id, uint64_t pa);
+
+/* Local APIC timer.  Counts are in units of the timer's input
+   clock, which runs at an implementation-defined rate. */
+void lapic_timer_periodic (uint8_t vec_no, uint32_t count);
+void lapic_timer_oneshot (uint8_t vec_no, uint32_t count);
+uint32_t lapic_timer_current (void);
+
+#endif /* threads/apic.h */
@@ -0,0 +1,111 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <pqueue.h>
+#include <rbtree.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 8
+
+/* Interprocessor interrupt vectors, above the device interrupts
+   and below the APIC spurious vector. */
+#define CPU_RESCHEDULE_VEC 0xf0         /* Check for preemption. */
+#define CPU_TLB_VEC 0xf1                /* Flush the TLB. */
+
+/* Run queue of threads in THREAD_READY state on one CPU.
+   There is one FIFO list per priority level, and bit P of MASK
+   is set iff QUEUES[P] is non-empty, so pushing, popping and
+   finding the highest ready priority are all O(1).  Under the
+   completely fair scheduler the lists are unused and the threads
+   are kept in CFS_TREE by virtual runtime instead.  Real-time
+   threads are kept apart, in RT_QUEUE and DL_TREE, and run
+   before all of the others. */
+#if PRI_MAX - PRI_MIN >= 64
+#error runqueue mask needs one bit per priority level
+#endif
+struct runqueue {
+	struct spinlock lock;               /* Protects the members below. */
+	struct list queues[PRI_MAX - PRI_MIN + 1];
+	uint64_t mask;                      /* Non-empty queues. */
+	size_t cnt;                         /* # of threads in QUEUES. */
+	struct rb_tree cfs_tree;            /* CFS: ready threads by vruntime. */
+	unsigned long cfs_load;             /* CFS: total weight of CFS_TREE. */
+	int64_t min_vruntime;               /* CFS: floor for placing threads. */
+	struct pqueue rt_queue;             /* SCHED_FIFO threads by priority. */
+	struct rb_tree dl_tree;             /* SCHED_DEADLINE threads by deadline. */
+	bool rt_throttled;                  /* SCHED_FIFO used up its bandwidth. */
+};
+
+struct task_state;
+
+/* Per-CPU data.  Only the CPU itself touches anything but RQ,
+   which other CPUs may steal threads from.
+
+   The GS base of each CPU points to its struct cpu, and the
+   first three members are at fixed offsets that the entry code
+   in intr-stubs.S and syscall-entry.S relies on. */
+struct cpu {
+	struct cpu *self;                   /* This struct, at %gs:0. */
+	uint64_t scratch;                   /* User rsp during syscall entry. */
+	struct task_state *tss;             /* This CPU's TSS. */
+	unsigned id;                        /* Index in cpus[]. */
+	unsigned apic_id;                   /* ID of its local APIC. */
+	volatile bool online;               /* Running the scheduler? */
+	struct thread *idle_thread;         /* This CPU's idle thread. */
+	struct thread *curr;                /* Thread running on this CPU. */
+	struct runqueue rq;                 /* Ready threads. */
+	struct thread *handoff;             /* Thread to run next, off RQ. */
+
+	/* Interrupts.  See interrupt.c. */
+	bool in_external_intr;              /* Handling an external interrupt? */
+	bool yield_on_return;               /* Yield on interrupt return? */
+	int64_t local_ticks;                /* # of timer interrupts here. */
+
+	/* Address space.  Other CPUs set TLB_FLUSH to have this CPU
+	   flush its TLB after they change PML4. */
+	uint64_t *pml4;                     /* Page table in CR3. */
+	volatile bool tlb_flush;            /* TLB flush requested? */
+
+	/* Spinlocks.  Interrupts are off while SPIN_DEPTH > 0. */
+	int spin_depth;                     /* # of spinlocks held. */
+	enum intr_level spin_level;         /* Interrupt level before them. */
+
+	/* FPU.  Other CPUs may read FPU_OWNER to avoid stealing it. */
+	struct thread *fpu_owner;           /* Thread whose FPU state is loaded. */
+	bool in_kernel_fpu;                 /* In kernel_fpu_begin()? */
+	bool kernel_fpu_intr_on;            /* Interrupts on before it? */
+
+	/* Scheduling. */
+	unsigned thread_ticks;              /* # of timer ticks since last yield. */
+	uint64_t slice_end;                 /* CFS: when CURR's slice ends, in ns. */
+	uint64_t rt_time;                   /* SCHED_FIFO run time in this window. */
+	uint64_t rt_window_end;             /* End of the current window, in ns. */
+	uint64_t rcu_qs;                    /* # of passes through the scheduler. */
+
+	/* Statistics. */
+	long long idle_ticks;               /* # of timer ticks spent idle. */
+	long long kernel_ticks;             /* # of timer ticks in kernel threads. */
+	long long user_ticks;               /* # of timer ticks in user programs. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+void cpu_init (void);
+void cpu_init_ap (void);
+void cpu_start_aps (void);
+struct cpu *cpu_current (void);
+void cpu_kick (struct cpu *);
+void cpu_tlb_shootdown (uint64_t *pml4);
+
+void kernel_lock (void);
+void kernel_unlock (void);
+bool kernel_lock_held (void);
+
+#endif /* threads/cpu.h */
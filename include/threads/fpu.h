@@ -0,0 +1,19 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+void fpu_init (void);
+void fpu_init_ap (void);
+void fpu_switch (struct thread *next);
+void fpu_sync (void);
+void fpu_unload (struct thread *);
+bool fpu_copy (struct thread *parent);
+void fpu_release (struct thread *);
+
+void kernel_fpu_begin (void);
+void kernel_fpu_end (void);
+
+#endif /* threads/fpu.h */
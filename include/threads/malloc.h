@@ -4,10 +4,23 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Statistics reported by malloc_get_stats(). */
+struct malloc_stats {
+	unsigned long long alloc_cnt;       /* Calls to malloc(). */
+	unsigned long long alloc_cycles;    /* Time-stamp cycles spent in them. */
+	unsigned long long bytes_requested; /* Bytes asked for in size classes... */
+	unsigned long long bytes_allocated; /* ...and the size of the blocks. */
+	size_t bytes_live;                  /* Bytes of blocks now in use... */
+	size_t arena_bytes;                 /* ...out of those held in arenas. */
+	size_t big_pages;                   /* Pages held by big blocks. */
+};
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_get_stats (struct malloc_stats *);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -8,16 +9,29 @@
 enum palloc_flags {
 	PAL_ASSERT = 001,           /* Panic on failure. */
 	PAL_ZERO = 002,             /* Zero page contents. */
-	PAL_USER = 004              /* User page. */
+	PAL_USER = 004,             /* User page. */
+	PAL_NORECLAIM = 010         /* Fail rather than reclaim cached pages. */
 };
 
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
+/* Watermarks of each pool's pages zeroed by the idle thread. */
+extern size_t palloc_zero_low;
+extern size_t palloc_zero_high;
+
 uint64_t palloc_init (void);
+void palloc_init_high (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_set_owner (void *pages, size_t page_cnt, void *owner);
+void *palloc_get_owner (const void *page);
+size_t palloc_count_free (enum palloc_flags, size_t *largest);
+void palloc_print_stats (void);
+bool palloc_zero_idle (void);
+void palloc_zero_counts (enum palloc_flags, size_t *ready,
+		unsigned long long *hits, unsigned long long *misses);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,47 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Read-copy-update.
+
+   Readers of an RCU-protected structure bracket their accesses
+   with rcu_read_lock() and rcu_read_unlock(), take no lock, and
+   do not block or get preempted in between.  A writer, excluded
+   from other writers by an ordinary lock, publishes a change so
+   that readers see either the old or the new version (see the
+   _rcu functions in lib/kernel/list.h), then waits for every
+   reader that might still see the old version before freeing it,
+   either synchronously with synchronize_rcu() or in the
+   background with call_rcu().
+
+   A CPU passes through a quiescent state, in which it cannot be
+   in a read-side critical section, each time it goes through the
+   scheduler.  A grace period ends once every CPU has done so. */
+struct rcu_head;
+typedef void rcu_func (struct rcu_head *);
+
+/* Embedded in a structure to be freed by call_rcu(). */
+struct rcu_head {
+	struct list_elem elem;      /* Element in the callback list. */
+	rcu_func *func;             /* Called after a grace period. */
+};
+
+/* Converts pointer to RCU head RCU_HEAD into a pointer to the
+   structure that it is embedded inside, like list_entry(). */
+#define rcu_entry(RCU_HEAD, STRUCT, MEMBER)             \
+	((STRUCT *) ((uint8_t *) &(RCU_HEAD)->func      \
+		- offsetof (STRUCT, MEMBER.func)))
+
+void rcu_init (void);
+
+void rcu_read_lock (void);
+void rcu_read_unlock (void);
+
+void synchronize_rcu (void);
+void call_rcu (struct rcu_head *, rcu_func *);
+void rcu_barrier (void);
+
+#endif /* threads/rcu.h */
@@ -0,0 +1,29 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of a single type, packed into
+   page-sized slabs with no per-object header and no rounding up
+   beyond pointer alignment, so a type that malloc() would round
+   up to the next power of two wastes nothing.  An optional
+   constructor puts each object into a known state when its slab
+   is created; the cache keeps it in that state, and the user must
+   return objects to it in that state too. */
+struct kmem_cache;
+typedef void kmem_ctor (void *);
+
+void kmem_cache_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void *kmem_cache_zalloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+size_t kmem_cache_shrink (struct kmem_cache *);
+
+size_t kmem_cache_reap (void);
+void kmem_cache_print_stats (void);
+
+#endif /* threads/slab.h */
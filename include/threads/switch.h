@@ -0,0 +1,31 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* switch_threads()'s stack frame: the callee-saved registers of
+   the System V AMD64 ABI, pushed on the kernel stack of the thread
+   being switched away from, below the return address. */
+struct switch_threads_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);         /* Return address. */
+};
+
+/* Saves the callee-saved registers on the current kernel stack,
+   stores the stack pointer in *CUR_STACK, switches to NEXT_STACK
+   and restores the registers that were saved there.  Interrupts
+   must be off. */
+void switch_threads (uint8_t **cur_stack, uint8_t *next_stack);
+
+/* Entry point of a new kernel thread, which switch_threads()
+   "returns" to the first time the thread is scheduled.  Calls the
+   function thread_create() left in the frame's r12, passing r13
+   and r14 as its arguments. */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
@@ -2,17 +2,21 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pqueue.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct pqueue waiters;      /* Waiting threads, by priority. */
 };
 
+/* One waiter on a condition variable. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct pq_elem elem;                /* Priority queue element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Waiting thread. */
 };
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
@@ -24,6 +28,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct pq_elem elem;        /* Element in holder's held_locks. */
+	int priority;               /* Priority donated to the holder. */
 };
 
 void lock_init (struct lock *);
@@ -31,10 +37,13 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_update_donation (struct thread *);
+bool lock_priority_less (const struct pq_elem *, const struct pq_elem *,
+		void *aux);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct pqueue waiters;      /* Waiting semaphore_elems, by priority. */
 };
 
 void cond_init (struct condition *);
@@ -42,6 +51,21 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Spinlock.  For short critical sections that must not sleep,
+   such as the run queues.  Interrupts are off while any spinlock
+   is held, so it also excludes interrupt handlers on the same
+   CPU.  The interrupt level to go back to is kept per CPU, not
+   per lock, so spinlocks may be released in any order. */
+struct spinlock {
+	volatile int locked;        /* Nonzero if held. */
+	struct cpu *cpu;            /* CPU holding it (for debugging). */
+};
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_held_by_current_cpu (const struct spinlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
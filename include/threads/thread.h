@@ -3,12 +3,12 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "devices/timer.h"
 #include "synch.h"
-#ifdef VM
-#include "vm/vm.h"
-#endif
 
 
 /* States in a thread's life cycle. */
@@ -19,12 +19,6 @@ enum thread_status {
 	THREAD_DYING        /* About to be destroyed. */
 };
 
-struct exit_info {
-    int pid;
-    int exit_status;
-    struct list_elem p_elem;
-};
-
 /* Thread identifier type.
    You can redefine this to whatever type you like. */
 typedef int tid_t;
@@ -35,6 +29,38 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness. */
+#define NICE_MIN -20                    /* Greatest share of the CPU. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least share of the CPU. */
+
+/* Scheduling classes.  A ready thread of a higher class always
+   runs before any thread of a lower class. */
+enum sched_policy {
+	SCHED_NORMAL,       /* Priorities, the MLFQS or CFS. */
+	SCHED_FIFO,         /* Fixed real-time priority, no time slice. */
+	SCHED_DEADLINE      /* Earliest deadline first, within a budget. */
+};
+
+/* SCHED_FIFO priorities. */
+#define RT_PRI_MIN 1                    /* Lowest real-time priority. */
+#define RT_PRI_MAX 99                   /* Highest real-time priority. */
+
+/* SCHED_DEADLINE reservation and state.  The thread may run for
+   RUNTIME ns in every PERIOD ns, and each such job must finish
+   within DEADLINE ns of the start of its period. */
+struct sched_dl {
+	uint64_t runtime;                   /* Budget per period, in ns. */
+	uint64_t deadline;                  /* Relative deadline, in ns. */
+	uint64_t period;                    /* Period, in ns. */
+	uint64_t bw;                        /* RUNTIME / PERIOD, fixed point. */
+	uint64_t period_start;              /* Start of the current period. */
+	uint64_t abs_deadline;              /* Deadline of the current job. */
+	int64_t left;                       /* Budget left in this period. */
+	bool throttled;                     /* Out of budget until next period. */
+	struct hrtimer timer;               /* Replenishes the budget. */
+};
+
 /* macros for mlfqs
   n : integer,
   x,y : fixed point numbers*/
@@ -51,9 +77,6 @@ typedef int tid_t;
 #define div_x_by_y(x,y) (((int64_t) (x)) * (FC) / (y)) // 고정소수점 수 x를 y로 나눈 값
 #define div_x_by_n(x,n) ((x) / (n)) // 고정소수점 수 x를 정수 n으로 나눈 값
 
-
-#define MIN_FD 3
-#define MAX_FD 63
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -78,7 +101,7 @@ typedef int tid_t;
  *           |                                 |
  *           +---------------------------------+
  *           |              magic              |
- *           |            intr_frame           |
+ *           |              stack              |
  *           |                :                |
  *           |                :                |
  *           |               name              |
@@ -110,57 +133,53 @@ typedef int tid_t;
  * semaphore wait list (synch.c).  It can be used these two ways
  * only because they are mutually exclusive: only a thread in the
  * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+ * blocked state is on a semaphore wait list.
+ *
+ * The members that the scheduler touches on every switch and
+ * tick come first, so that they share as few cache lines as
+ * possible.  Everything that belongs to a user process, rather
+ * than to one of its threads, is in its `struct process'. */
 struct thread {
-	/* Owned by thread.c. */
+	/* Owned by thread.c; hot. */
 	tid_t tid;                          /* Thread identifier. */
 	enum thread_status status;          /* Thread state. */
-	char name[16];                      /* Name (for debugging purposes). */
+	enum sched_policy policy;           /* Scheduling class. */
 	int priority;                       /* Priority. */
-	/* TO DO: add local tick(the time to wake up)*/
-	int64_t wakeup_tick;
+	struct cpu *cpu;                    /* CPU it runs or is queued on. */
+	struct process *proc;               /* Process, or NULL if a kernel thread. */
+	uint8_t *stack;                     /* Saved stack pointer, for switching. */
+	void *fpu;                          /* FPU save area, or NULL (fpu.c). */
+	uint64_t exec_start;                /* When vruntime was last charged. */
+	int64_t vruntime;                   /* CFS virtual runtime, in ns. */
+	uint64_t ru_stamp;                  /* When RU's times were last charged. */
+	int rt_priority;                    /* SCHED_FIFO priority. */
+
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
-	
-	struct list donations; // 나에게 후원한 스레드들 리스트
-	struct list_elem d_elem; // 내가 후원할 스레드에게 내 정보를 저장하게 함
-	struct lock *wait_on_lock; // 내가 기다리는 락
-	int original_priority; // 내 priority가 후원을 받아서 높아져도 원래 priority를 저장하기 위해
-
-	int nice;
-	int recent_cpu;
-
-	int exit_status;
-	char p_name[256];
-
-	struct list child_list;
-	struct list_elem c_elem; // child elem..
-	struct file *fdt[64];
-	int waiting_child; // 필요 x 
-	struct thread* parent;
-	struct file *loaded_file;
-	struct semaphore fork_sema;
-	struct semaphore wait_sema;
-	struct semaphore exit_sema;
-	struct intr_frame parent_if;
-	int child_exit_status;
-	int is_exit;
-	struct list exit_child_list;
-	//struct list killed_list;
-	//struct list_elem k_elem;
-	
-#ifdef USERPROG
-	/* Owned by userprog/process.c. */
-	uint64_t *pml4;                     /* Page map level 4 */
-	
-#endif
-#ifdef VM
-	/* Table for whole virtual memory owned by thread. */
-	struct supplemental_page_table spt;
-#endif
+	struct rb_node rb_elem;             /* Element in a CFS or EDF run queue. */
+	struct pq_elem rt_elem;             /* Element in a FIFO run queue. */
+
+	/* Owned by thread.c. */
+	char name[16];                      /* Name (for debugging purposes). */
+	int64_t wakeup_tick;                /* When a sleeping thread wakes up. */
+	int nice;                           /* MLFQS and CFS niceness. */
+	int recent_cpu;                     /* MLFQS recent CPU, fixed point. */
+	int64_t mlfqs_epoch;                /* Epoch recent_cpu is up to date with. */
+	struct sched_dl dl;                 /* SCHED_DEADLINE state. */
+	struct rusage ru;                   /* Resources used so far. */
+	int rcu_nesting;                    /* Depth of rcu_read_lock() calls. */
+	bool rcu_yield;                     /* Preemption put off by a reader? */
+	struct list_elem allelem;           /* List element for all threads list. */
+
+	/* Shared between thread.c and synch.c. */
+	struct pqueue held_locks;           /* Locks held, by donated priority. */
+	struct lock *wait_on_lock;          /* Lock being waited for, if any. */
+	struct pq_elem wait_elem;           /* Element in a semaphore's waiters. */
+	struct pqueue *wait_queue;          /* Queue keyed by our priority, if any. */
+	struct pq_elem *wait_key;           /* Our element in WAIT_QUEUE. */
+	int original_priority;              /* Priority before donations. */
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -170,14 +189,35 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which ignores
+   priorities and shares the CPU in proportion to weights derived
+   from nice values.
+   Controlled by kernel command-line option "-o cfs". */
+extern bool thread_cfs;
+
+/* Most pages of exited threads to keep for new threads.
+   Controlled by kernel command-line option "-tcache=COUNT". */
+extern size_t thread_cache_max;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
+void thread_tick_idle (int64_t cnt);
 void thread_print_stats (void);
+size_t thread_cache_shrink (void);
+
+void thread_enter_kernel (void);
+void thread_leave_kernel (void);
+void thread_get_rusage (struct rusage *);
+void rusage_add (struct rusage *, const struct rusage *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_in (struct process *, const char *name, int priority,
+		thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -188,10 +228,18 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+bool thread_yield_to (struct thread *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
 
+bool thread_set_fifo (int rt_priority);
+bool thread_set_deadline (uint64_t runtime, uint64_t deadline,
+		uint64_t period);
+void thread_set_normal (void);
+enum sched_policy thread_get_policy (void);
+void thread_yield_period (void);
+
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
@@ -199,11 +247,18 @@ int thread_get_load_avg (void);
 
 void do_iret (struct intr_frame *tf);
 
-struct list ready_list;
-struct list sleep_list; 
-struct list wait_list;
+void thread_set_effective_priority (struct thread *, int);
+size_t thread_ready_count (void);
+
+void thread_sleep (int64_t ticks);
+void thread_wakeup (int64_t ticks);
+int64_t thread_next_wakeup (void);
+
+void thread_mlfqs_tick (int64_t ticks);
+void thread_mlfqs_update (struct thread *);
+
+extern struct list wait_list;
 void thread_test_preemption (void);
-struct thread *idle_thread;
-int READY_THREADS;
-int LOAD_AVG;
+extern int READY_THREADS;
+extern int LOAD_AVG;
 #endif /* threads/thread.h */
@@ -0,0 +1,49 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+/* Deferred work.
+
+   A work item is a function to be called later, in thread context,
+   by one of the kernel threads of a workqueue.  Work can be queued
+   from anywhere, including interrupt handlers, so an interrupt
+   handler can hand off whatever does not have to be done with
+   interrupts off. */
+struct work;
+typedef void work_func (struct work *);
+
+struct work {
+	struct list_elem elem;      /* Element in the workqueue's list. */
+	work_func *func;            /* Called by a worker thread. */
+	void *aux;                  /* Free for FUNC's use. */
+	bool pending;               /* Queued, but not yet started? */
+};
+
+/* A work item that is queued after a delay. */
+struct delayed_work {
+	struct work work;
+	struct hrtimer timer;       /* Queues WORK when it expires. */
+	struct workqueue *wq;       /* Queue to put WORK on. */
+};
+
+void work_init (struct work *, work_func *, void *aux);
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+
+struct workqueue *workqueue_create (const char *name, int priority,
+		size_t thread_cnt);
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+		int64_t ticks);
+bool cancel_delayed_work (struct delayed_work *);
+void flush_workqueue (struct workqueue *);
+
+/* Workqueue for work that has no need of its own. */
+extern struct workqueue *system_wq;
+void workqueue_init (void);
+
+#endif /* threads/workqueue.h */
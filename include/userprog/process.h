@@ -1,8 +1,60 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
+#include <rusage.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
+/* File descriptors handed out by open().  0, 1 and 2 are the
+   console. */
+#define MIN_FD 3
+#define MAX_FD 63
+#define FDT_SIZE (MAX_FD + 1)       /* Size of the fd table. */
+
+/* A user process.  Its threads share its address space, open
+   files and executable, and its parent waits for it here.  A
+   process outlives its thread until its parent has waited for
+   it or exited itself.  Kernel threads belong to no process.
+
+   Process structures come from their own cache in process.c,
+   not from the thread's page, so that `struct thread' keeps to
+   a few cache lines and leaves the rest of its page to the
+   kernel stack. */
+struct process {
+	tid_t pid;                          /* Tid of its initial thread. */
+
+	/* Address space. */
+	uint64_t *pml4;                     /* Page map level 4. */
+#ifdef VM
+	struct supplemental_page_table spt; /* Virtual memory. */
+#endif
+
+	/* Files. */
+	struct file *fdt[FDT_SIZE];         /* Open files, by descriptor. */
+	struct file *loaded_file;           /* Executable, denied writes. */
+
+	/* Parent and children.  Only the process's own thread changes
+	   CHILDREN; the rest is protected by disabling interrupts. */
+	struct process *parent;             /* Parent, or NULL if orphaned. */
+	struct list children;               /* Live and exited children. */
+	struct list_elem child_elem;        /* Element in parent's CHILDREN. */
+	bool exited;                        /* Has its thread exited? */
+	int exit_status;                    /* Status passed to exit(). */
+	struct semaphore wait_sema;         /* Upped when it exits. */
+	struct semaphore fork_sema;         /* Upped when fork() is done. */
+	struct intr_frame fork_if;          /* User context being forked. */
+	struct rusage child_ru;             /* Usage of children that exited. */
+};
+
+/* Back aligned 2 MB runs of user memory with large pages? */
+extern bool thp_enabled;
+
+void process_cache_init (void);
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
@@ -10,4 +62,6 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
 bool duplicate_pte (uint64_t *pte, void *va, void *aux);
+struct process *process_current (void);
+struct process *process_get_child (tid_t);
 #endif /* userprog/process.h */
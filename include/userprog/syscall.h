@@ -2,6 +2,7 @@
 #define USERPROG_SYSCALL_H
 
 void syscall_init (void);
+void syscall_init_ap (void);
 
 struct lock sysfile_lock;
 void sys_exit(int status);
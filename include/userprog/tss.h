@@ -22,8 +22,8 @@ struct task_state {
 	uint16_t iomb;
 }__attribute__ ((packed));
 
-struct task_state;
-void tss_init (void);
+struct cpu;
+void tss_init (struct cpu *);
 struct task_state *tss_get (void);
 void tss_update (struct thread *next);
 
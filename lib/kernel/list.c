@@ -318,6 +318,70 @@ list_reverse (struct list *list) {
 	}
 }
 
+/* Keeps the compiler from moving memory accesses across it, so
+   that an element is complete before a reader can reach it.  (A
+   single CPU, or x86's ordering of stores, makes a fence
+   unnecessary.) */
+#define publish_barrier() asm volatile ("" : : : "memory")
+
+/* Returns the first element of LIST, or its tail if it is empty,
+   for a reader walking LIST in an RCU read-side critical
+   section. */
+struct list_elem *
+list_begin_rcu (struct list *list) {
+	ASSERT (list != NULL);
+	return *(struct list_elem * volatile *) &list->head.next;
+}
+
+/* Returns the element after ELEM, for a reader walking a list in
+   an RCU read-side critical section.  ELEM may already have been
+   removed from the list, in which case this still leads back into
+   it. */
+struct list_elem *
+list_next_rcu (struct list_elem *elem) {
+	ASSERT (is_head (elem) || is_interior (elem));
+	return *(struct list_elem * volatile *) &elem->next;
+}
+
+/* Inserts ELEM just before BEFORE, like list_insert(), such that a
+   concurrent reader sees either the list without ELEM or ELEM with
+   its links already set.  Writers must exclude each other. */
+void
+list_insert_rcu (struct list_elem *before, struct list_elem *elem) {
+	ASSERT (is_interior (before) || is_tail (before));
+	ASSERT (elem != NULL);
+
+	elem->prev = before->prev;
+	elem->next = before;
+	publish_barrier ();
+	*(struct list_elem * volatile *) &before->prev->next = elem;
+	before->prev = elem;
+}
+
+/* Inserts ELEM at the beginning of LIST, for RCU readers. */
+void
+list_push_front_rcu (struct list *list, struct list_elem *elem) {
+	list_insert_rcu (list_begin (list), elem);
+}
+
+/* Inserts ELEM at the end of LIST, for RCU readers. */
+void
+list_push_back_rcu (struct list *list, struct list_elem *elem) {
+	list_insert_rcu (list_end (list), elem);
+}
+
+/* Removes ELEM from its list, like list_remove(), but leaves
+   ELEM's own links alone so that a reader standing on it can
+   still move on.  ELEM must not be freed or reused until a grace
+   period has passed (see synchronize_rcu() and call_rcu()).
+   Writers must exclude each other. */
+void
+list_remove_rcu (struct list_elem *elem) {
+	ASSERT (is_interior (elem));
+	*(struct list_elem * volatile *) &elem->prev->next = elem->next;
+	elem->next->prev = elem->prev;
+}
+
 /* Returns true only if the list elements A through B (exclusive)
    are in order according to LESS given auxiliary data AUX. */
 static bool
@@ -0,0 +1,183 @@
+/* Priority queue.
+
+   See pqueue.h for basic information.  The pairing heap and its
+   two-pass merge are from Fredman, Sedgewick, Sleator and Tarjan,
+   "The Pairing Heap: A New Form of Self-Adjusting Heap",
+   Algorithmica 1 (1986). */
+
+#include "pqueue.h"
+#include "../debug.h"
+
+static bool goes_before (const struct pqueue *,
+		const struct pq_elem *, const struct pq_elem *);
+static struct pq_elem *meld (struct pqueue *,
+		struct pq_elem *, struct pq_elem *);
+static struct pq_elem *merge_pairs (struct pqueue *, struct pq_elem *);
+static void cut (struct pq_elem *);
+
+/* Initializes PQ as an empty priority queue that compares
+   elements using LESS, given auxiliary data AUX. */
+void
+pq_init (struct pqueue *pq, pq_less_func *less, void *aux) {
+	ASSERT (pq != NULL);
+	ASSERT (less != NULL);
+
+	pq->root = NULL;
+	pq->elem_cnt = 0;
+	pq->seq = 0;
+	pq->less = less;
+	pq->aux = aux;
+}
+
+/* Returns the number of elements in PQ. */
+size_t
+pq_size (const struct pqueue *pq) {
+	return pq->elem_cnt;
+}
+
+/* Returns true if PQ is empty, false otherwise. */
+bool
+pq_empty (const struct pqueue *pq) {
+	return pq->root == NULL;
+}
+
+/* Inserts E into PQ. */
+void
+pq_push (struct pqueue *pq, struct pq_elem *e) {
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	e->seq = pq->seq++;
+	pq->root = meld (pq, pq->root, e);
+	pq->elem_cnt++;
+}
+
+/* Returns the greatest element in PQ, the one that pq_pop()
+   would remove.  PQ must not be empty. */
+struct pq_elem *
+pq_max (const struct pqueue *pq) {
+	ASSERT (!pq_empty (pq));
+	return pq->root;
+}
+
+/* Removes and returns the greatest element in PQ.  Of several
+   equal elements, the one pushed first is removed.  PQ must not
+   be empty. */
+struct pq_elem *
+pq_pop (struct pqueue *pq) {
+	struct pq_elem *max = pq_max (pq);
+
+	pq->root = merge_pairs (pq, max->child);
+	pq->elem_cnt--;
+	return max;
+}
+
+/* Removes E, which must be in PQ, from PQ. */
+void
+pq_remove (struct pqueue *pq, struct pq_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e == pq->root) {
+		pq_pop (pq);
+		return;
+	}
+	cut (e);
+	pq->root = meld (pq, pq->root, merge_pairs (pq, e->child));
+	pq->elem_cnt--;
+}
+
+/* Moves E, which must be in PQ, to its proper place after its
+   value has changed.  E keeps its place among the elements that
+   now compare equal to it. */
+void
+pq_update (struct pqueue *pq, struct pq_elem *e) {
+	uint64_t seq = e->seq;
+
+	pq_remove (pq, e);
+	e->child = e->next = e->prev = NULL;
+	e->seq = seq;
+	pq->root = meld (pq, pq->root, e);
+	pq->elem_cnt++;
+}
+
+/* Returns true if A must come out of PQ before B. */
+static bool
+goes_before (const struct pqueue *pq,
+		const struct pq_elem *a, const struct pq_elem *b) {
+	if (pq->less (b, a, pq->aux))
+		return true;
+	if (pq->less (a, b, pq->aux))
+		return false;
+	return a->seq < b->seq;
+}
+
+/* Melds the trees rooted at A and B, either of which may be null,
+   by making the lesser root the leftmost child of the greater.
+   A and B must not have siblings.  Returns the new root. */
+static struct pq_elem *
+meld (struct pqueue *pq, struct pq_elem *a, struct pq_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (goes_before (pq, b, a)) {
+		struct pq_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the list of sibling trees that starts at FIRST into a
+   single tree and returns its root, or a null pointer if FIRST
+   is null.  Melds the trees in pairs from left to right, then
+   melds the pairs into one from right to left. */
+static struct pq_elem *
+merge_pairs (struct pqueue *pq, struct pq_elem *first) {
+	struct pq_elem *pairs = NULL;   /* Melded pairs, last first. */
+	struct pq_elem *root = NULL;
+
+	while (first != NULL) {
+		struct pq_elem *a = first;
+		struct pq_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL) {
+			b->next = b->prev = NULL;
+			a = meld (pq, a, b);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	while (pairs != NULL) {
+		struct pq_elem *a = pairs;
+
+		pairs = a->next;
+		a->next = NULL;
+		root = meld (pq, root, a);
+	}
+	return root;
+}
+
+/* Detaches the subtree rooted at E, which must not be the root,
+   from its parent and siblings. */
+static void
+cut (struct pq_elem *e) {
+	ASSERT (e->prev != NULL);
+
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
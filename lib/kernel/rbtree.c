@@ -0,0 +1,319 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  Insertion and removal
+   follow Cormen, Leiserson, Rivest and Stein, "Introduction to
+   Algorithms", chapter 13, with null pointers in place of the
+   sentinel leaf. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void replace_child (struct rb_tree *, struct rb_node *parent,
+		struct rb_node *old, struct rb_node *new);
+static void rotate_left (struct rb_tree *, struct rb_node *);
+static void rotate_right (struct rb_tree *, struct rb_node *);
+static void insert_fixup (struct rb_tree *, struct rb_node *);
+static void remove_fixup (struct rb_tree *, struct rb_node *,
+		struct rb_node *parent);
+static bool is_red (const struct rb_node *);
+
+/* Initializes TREE as an empty red-black tree that orders
+   elements using LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) {
+	ASSERT (tree != NULL);
+	ASSERT (less != NULL);
+
+	tree->root = tree->min = NULL;
+	tree->elem_cnt = 0;
+	tree->less = less;
+	tree->aux = aux;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rb_tree *tree) {
+	return tree->elem_cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) {
+	return tree->root == NULL;
+}
+
+/* Inserts E into TREE, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_node *e) {
+	struct rb_node *parent = NULL;
+	struct rb_node **link = &tree->root;
+	bool leftmost = true;
+
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (tree->less (e, parent, tree->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+	if (leftmost)
+		tree->min = e;
+	tree->elem_cnt++;
+	insert_fixup (tree, e);
+}
+
+/* Removes E, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_node *e) {
+	struct rb_node *child, *parent;
+	bool red;
+
+	ASSERT (e != NULL);
+	ASSERT (tree->elem_cnt > 0);
+
+	if (tree->min == e)
+		tree->min = rb_next (e);
+
+	if (e->left == NULL || e->right == NULL) {
+		/* E has at most one child, which takes its place. */
+		child = e->left != NULL ? e->left : e->right;
+		parent = e->parent;
+		red = e->red;
+		if (child != NULL)
+			child->parent = parent;
+		replace_child (tree, parent, e, child);
+	} else {
+		/* E's successor Y, which has no left child, is moved into
+		   E's place, and Y's right child into Y's. */
+		struct rb_node *y = e->right;
+
+		while (y->left != NULL)
+			y = y->left;
+		child = y->right;
+		parent = y->parent;
+		red = y->red;
+		if (parent == e)
+			parent = y;
+		else {
+			parent->left = child;
+			y->right = e->right;
+			e->right->parent = y;
+		}
+		if (child != NULL)
+			child->parent = parent;
+		y->parent = e->parent;
+		y->left = e->left;
+		y->red = e->red;
+		replace_child (tree, e->parent, e, y);
+		e->left->parent = y;
+	}
+
+	tree->elem_cnt--;
+	if (!red)
+		remove_fixup (tree, child, parent);
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_node *
+rb_min (const struct rb_tree *tree) {
+	return tree->min;
+}
+
+/* Removes and returns the least element in TREE, or returns a
+   null pointer if TREE is empty.  Of several equal elements, the
+   one inserted first is removed. */
+struct rb_node *
+rb_pop_min (struct rb_tree *tree) {
+	struct rb_node *min = tree->min;
+
+	if (min != NULL)
+		rb_remove (tree, min);
+	return min;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest element. */
+struct rb_node *
+rb_next (struct rb_node *e) {
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return e;
+	}
+	while (e->parent != NULL && e->parent->right == e)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as the
+   root of TREE if PARENT is null. */
+static void
+replace_child (struct rb_tree *tree, struct rb_node *parent,
+		struct rb_node *old, struct rb_node *new) {
+	if (parent == NULL)
+		tree->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Makes X's right child take X's place, with X as its left
+   child. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_node *x) {
+	struct rb_node *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Makes X's left child take X's place, with X as its right
+   child. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_node *x) {
+	struct rb_node *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black properties after E was inserted as a
+   red leaf. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_node *e) {
+	struct rb_node *p;
+
+	while ((p = e->parent) != NULL && p->red) {
+		struct rb_node *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_node *u = g->right;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				e = g;
+				continue;
+			}
+			if (e == p->right) {
+				rotate_left (tree, p);
+				e = p;
+				p = e->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_right (tree, g);
+		} else {
+			struct rb_node *u = g->left;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				e = g;
+				continue;
+			}
+			if (e == p->left) {
+				rotate_right (tree, p);
+				e = p;
+				p = e->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_left (tree, g);
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above X, which may be null, leaving the paths
+   through X one black node short.  PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_node *x,
+		struct rb_node *parent) {
+	while (x != tree->root && !is_red (x)) {
+		if (x == parent->left) {
+			struct rb_node *w = parent->right;
+
+			if (w->red) {
+				w->red = false;
+				parent->red = true;
+				rotate_left (tree, parent);
+				w = parent->right;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->right)) {
+					w->left->red = false;
+					w->red = true;
+					rotate_right (tree, w);
+					w = parent->right;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->right->red = false;
+				rotate_left (tree, parent);
+				x = tree->root;
+			}
+		} else {
+			struct rb_node *w = parent->left;
+
+			if (w->red) {
+				w->red = false;
+				parent->red = true;
+				rotate_right (tree, parent);
+				w = parent->left;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->left)) {
+					w->right->red = false;
+					w->red = true;
+					rotate_left (tree, w);
+					w = parent->left;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->left->red = false;
+				rotate_right (tree, parent);
+				x = tree->root;
+			}
+		}
+	}
+	if (x != NULL)
+		x->red = false;
+}
+
+/* Returns true if E is a red node.  Null leaves are black. */
+static bool
+is_red (const struct rb_node *e) {
+	return e != NULL && e->red;
+}
@@ -0,0 +1,125 @@
+/* Puts thousands of threads to sleep at once, with deadlines
+   spread over several hundred ticks, and checks that every one
+   of them wakes up, none of them early.  Exercises the sleep
+   queue with many sleepers per tick and sleepers that start out
+   far enough in the future to be moved between wheel levels. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define THREAD_CNT 2000
+
+/* Number of times each thread sleeps. */
+#define ITERATION_CNT 2
+
+static void test_sleep (void);
+
+void
+test_alarm_many (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  test_sleep ();
+}
+
+void
+test_mlfqs_alarm_many (void)
+{
+  ASSERT (thread_mlfqs);
+
+  test_sleep ();
+}
+
+/* Information about the test. */
+struct sleep_test
+  {
+    int64_t start;              /* Current time at start of test. */
+    int early_cnt;              /* Number of early wake-ups. */
+    int wakeup_cnt;             /* Number of wake-ups. */
+    struct semaphore done;      /* Upped by each thread when done. */
+  };
+
+/* Information about an individual thread in the test. */
+struct sleep_thread
+  {
+    struct sleep_test *test;    /* Info shared between all threads. */
+    int id;                     /* Sleeper ID. */
+  };
+
+static thread_func sleeper;
+
+static void
+test_sleep (void)
+{
+  struct sleep_test test;
+  struct sleep_thread *threads;
+  int i;
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATION_CNT);
+
+  threads = malloc (sizeof *threads * THREAD_CNT);
+  if (threads == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  test.start = timer_ticks () + 100;
+  test.early_cnt = 0;
+  test.wakeup_cnt = 0;
+  sema_init (&test.done, 0);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+      char name[16];
+
+      t->test = &test;
+      t->id = i;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, t);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+
+  msg ("%d wake-ups, %d early.", test.wakeup_cnt, test.early_cnt);
+  if (test.wakeup_cnt != THREAD_CNT * ITERATION_CNT)
+    fail ("expected %d wake-ups", THREAD_CNT * ITERATION_CNT);
+  if (test.early_cnt != 0)
+    fail ("threads woke up before their deadline");
+
+  free (threads);
+}
+
+/* Sleeper thread.  Sleeps ITERATION_CNT times, each time until a
+   deadline between 0 and 600 ticks after the previous one. */
+static void
+sleeper (void *t_)
+{
+  struct sleep_thread *t = t_;
+  struct sleep_test *test = t->test;
+  int64_t wakeup = test->start;
+  int i;
+
+  for (i = 0; i < ITERATION_CNT; i++)
+    {
+      enum intr_level old_level;
+
+      wakeup += (t->id * 7 + i * 131) % 600;
+      timer_sleep (wakeup - timer_ticks ());
+
+      old_level = intr_disable ();
+      if (timer_ticks () < wakeup)
+        test->early_cnt++;
+      test->wakeup_cnt++;
+      intr_set_level (old_level);
+    }
+  sema_up (&test->done);
+}
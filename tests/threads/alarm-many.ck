@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-many) begin
+(alarm-many) Creating 2000 threads to sleep 2 times each.
+(alarm-many) 4000 wake-ups, 0 early.
+(alarm-many) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Runs with the periodic tick stopped while idle ("-o tickless")
+   and sleeps for a range of durations, some shorter and some
+   much longer than one one-shot timer count can cover, with the
+   CPU otherwise idle.  Every sleep has to end on exactly the
+   tick it asked for: skipped ticks that are caught up on wrongly
+   show up as sleeps that are too short or too long. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static const int durations[] = {1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144};
+
+void
+test_alarm_tickless (void)
+{
+  size_t i;
+
+  ASSERT (timer_tickless);
+
+  msg ("Sleeping %zu times.", sizeof durations / sizeof *durations);
+  for (i = 0; i < sizeof durations / sizeof *durations; i++)
+    {
+      int64_t start = timer_ticks ();
+      int64_t elapsed;
+
+      timer_sleep (durations[i]);
+      elapsed = timer_elapsed (start);
+      if (elapsed != durations[i])
+        fail ("sleep of %d ticks took %"PRId64" ticks",
+              durations[i], elapsed);
+    }
+  msg ("All sleeps ended on time.");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) Sleeping 11 times.
+(alarm-tickless) All sleeps ended on time.
+(alarm-tickless) end
+EOF
+pass;
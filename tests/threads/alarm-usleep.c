@@ -0,0 +1,71 @@
+/* Sleeps for fractions of a timer tick with timer_usleep() and
+   timer_nsleep() and checks, against timer_now_ns(), that no
+   sleep ends early.  A lower-priority thread spins alongside and
+   has to get the CPU during every sleep, which it cannot if the
+   sleeps are implemented by busy-waiting. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeps. */
+#define SLEEP_CNT 30
+
+static thread_func spinner;
+
+static volatile int64_t spin_cnt;
+static volatile bool spin_done;
+static struct semaphore spin_sema;
+
+void
+test_alarm_usleep (void)
+{
+  int early_cnt = 0, busy_cnt = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&spin_sema, 0);
+  spin_done = false;
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+
+  msg ("Sleeping %d times.", SLEEP_CNT);
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t ns = 100 * 1000 * (i % 10 + 1);
+      int64_t before = spin_cnt;
+      uint64_t start = timer_now_ns ();
+
+      if (i % 2 == 0)
+        timer_usleep (ns / 1000);
+      else
+        timer_nsleep (ns);
+
+      if (timer_now_ns () - start < (uint64_t) ns)
+        early_cnt++;
+      if (spin_cnt == before)
+        busy_cnt++;
+    }
+
+  spin_done = true;
+  sema_down (&spin_sema);
+
+  if (early_cnt != 0)
+    fail ("%d of %d sleeps ended early", early_cnt, SLEEP_CNT);
+  if (busy_cnt != 0)
+    fail ("%d of %d sleeps kept the CPU", busy_cnt, SLEEP_CNT);
+  msg ("All sleeps ended on time without spinning.");
+}
+
+/* Counts for as long as the main thread sleeps. */
+static void
+spinner (void *aux UNUSED)
+{
+  while (!spin_done)
+    spin_cnt++;
+  sema_up (&spin_sema);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) Sleeping 30 times.
+(alarm-usleep) All sleeps ended on time without spinning.
+(alarm-usleep) end
+EOF
+pass;
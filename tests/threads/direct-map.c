@@ -0,0 +1,40 @@
+/* Checks the kernel's direct map of physical memory: memory away
+   from the kernel is mapped with 2 MB or larger pages, the kernel
+   text with read-only 4 kB pages, and addresses inside a large
+   page translate to the right physical address. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* A physical address well above the kernel, present in any
+   machine with the default amount of memory. */
+#define PROBE_PA (32UL << 20)
+
+void
+test_direct_map (void)
+{
+  uint64_t *pte;
+  size_t size;
+
+  pte = pml4e_lookup (base_pml4, (uint64_t) test_direct_map, &size);
+  if (pte == NULL || !(*pte & PTE_P))
+    fail ("kernel text is not mapped");
+  msg ("Kernel text mapped with %zu kB pages, %s.", size / 1024,
+       *pte & PTE_W ? "writable" : "read-only");
+
+  pte = pml4e_lookup (base_pml4, (uint64_t) ptov (PROBE_PA), &size);
+  if (pte == NULL || !(*pte & PTE_P))
+    fail ("physical address %#lx is not mapped", PROBE_PA);
+  msg ("Memory above the kernel mapped with %s pages.",
+       size >= LARGE_PGSIZE && (*pte & PTE_PS) ? "large" : "small");
+
+  pte = pml4e_lookup (base_pml4, (uint64_t) ptov (PROBE_PA + 0x12345),
+                      &size);
+  msg ("Offset into a large page translates %s.",
+       (PTE_ADDR (*pte) & ~(size - 1)) + ((PROBE_PA + 0x12345) & (size - 1))
+       == PROBE_PA + 0x12345 ? "correctly" : "wrongly");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(direct-map) begin
+(direct-map) Kernel text mapped with 4 kB pages, read-only.
+(direct-map) Memory above the kernel mapped with large pages.
+(direct-map) Offset into a large page translates correctly.
+(direct-map) end
+EOF
+pass;
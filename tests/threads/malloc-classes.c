@@ -0,0 +1,79 @@
+/* Allocates blocks of many sizes with malloc(), checks that they
+   do not overlap and survive realloc() within their size class,
+   and reports the average cost of an allocation.  Also checks that
+   blocks just over 2 kB, which used to take a page each, now share
+   pages, and that the size classes waste less than a fifth of the
+   bytes handed out. */
+
+#include <stdio.h>
+#include <string.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+
+#define BLOCK_CNT 300
+#define MID_CNT 64
+#define MID_SIZE 2200
+
+static unsigned char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+static void *mids[MID_CNT];
+
+void
+test_malloc_classes (void)
+{
+  struct malloc_stats before, after;
+  size_t free_before, free_mid;
+  unsigned long long requested, allocated;
+  void *same;
+  int i;
+  size_t j;
+
+  random_init (0);
+  malloc_get_stats (&before);
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      sizes[i] = 1 + random_ulong () % 6000;
+      blocks[i] = malloc (sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("malloc (%zu) failed", sizes[i]);
+      memset (blocks[i], i, sizes[i]);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < sizes[i]; j++)
+      if (blocks[i][j] != (unsigned char) i)
+        fail ("block %d of %zu bytes overlaps another", i, sizes[i]);
+  malloc_get_stats (&after);
+
+  requested = after.bytes_requested - before.bytes_requested;
+  allocated = after.bytes_allocated - before.bytes_allocated;
+  msg ("%d allocations: %llu cycles each on average.", BLOCK_CNT,
+       (after.alloc_cycles - before.alloc_cycles)
+       / (after.alloc_cnt - before.alloc_cnt));
+  msg ("Size classes waste %s a fifth of the bytes.",
+       (allocated - requested) * 5 < allocated ? "less than" : "at least");
+
+  /* Shrinking a little stays in the same block. */
+  same = realloc (blocks[0], sizes[0] - sizes[0] / 16);
+  msg ("realloc() to a slightly smaller size %s the block.",
+       same == blocks[0] ? "keeps" : "moves");
+  blocks[0] = same;
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+
+  /* Mid-size blocks share pages. */
+  free_before = palloc_count_free (0, NULL);
+  for (i = 0; i < MID_CNT; i++)
+    {
+      mids[i] = malloc (MID_SIZE);
+      if (mids[i] == NULL)
+        fail ("malloc (%d) failed", MID_SIZE);
+    }
+  free_mid = palloc_count_free (0, NULL);
+  msg ("%d blocks of %d bytes take %s than %d pages.", MID_CNT, MID_SIZE,
+       free_before - free_mid < MID_CNT ? "fewer" : "no fewer", MID_CNT);
+  for (i = 0; i < MID_CNT; i++)
+    free (mids[i]);
+}
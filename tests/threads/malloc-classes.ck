@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/\d+ cycles each/N cycles each/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(malloc-classes) begin
+(malloc-classes) 300 allocations: N cycles each on average.
+(malloc-classes) Size classes waste less than a fifth of the bytes.
+(malloc-classes) realloc() to a slightly smaller size keeps the block.
+(malloc-classes) 64 blocks of 2200 bytes take fewer than 64 pages.
+(malloc-classes) end
+EOF
+pass;
@@ -0,0 +1,102 @@
+/* Checks that the completely fair scheduler does not cost much
+   throughput.  Measures how much work one thread gets done in a
+   fixed number of ticks with the CPU to itself, then how much 8
+   threads get done in the same number of ticks together.  The
+   total must be at least 3/4 of the solo amount, and no thread
+   may get less than half of its fair share. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of worker threads. */
+#define THREAD_CNT 8
+
+/* Length of each measurement, in ticks. */
+#define SAMPLE_TICKS 200
+
+struct worker
+  {
+    int64_t start;              /* Tick to start working at. */
+    int64_t end;                /* Tick to stop working at. */
+    long long work;             /* Iterations done. */
+    struct semaphore *done;     /* Upped when finished. */
+  };
+
+static thread_func worker_thread;
+static long long do_work (int64_t start, int64_t end);
+
+void
+test_cfs_throughput (void) 
+{
+  struct worker workers[THREAD_CNT];
+  struct semaphore done;
+  long long solo, total;
+  int64_t start;
+  int i;
+
+  ASSERT (thread_cfs);
+
+  start = timer_ticks () + 1;
+  solo = do_work (start, start + SAMPLE_TICKS);
+  msg ("1 thread did %lld iterations in %d ticks.", solo, SAMPLE_TICKS);
+
+  sema_init (&done, 0);
+  start = timer_ticks () + 10;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct worker *w = &workers[i];
+      char name[16];
+
+      w->start = start;
+      w->end = start + SAMPLE_TICKS;
+      w->work = 0;
+      w->done = &done;
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_DEFAULT, worker_thread, w);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  total = 0;
+  for (i = 0; i < THREAD_CNT; i++)
+    total += workers[i].work;
+  msg ("%d threads did %lld iterations in %d ticks.",
+       THREAD_CNT, total, SAMPLE_TICKS);
+
+  if (total < solo / 4 * 3)
+    fail ("%d threads did only %lld%% of the work of 1 thread",
+          THREAD_CNT, total * 100 / solo);
+  for (i = 0; i < THREAD_CNT; i++)
+    if (workers[i].work < total / THREAD_CNT / 2)
+      fail ("worker %d did only %lld of %lld iterations",
+            i, workers[i].work, total);
+
+  pass ();
+}
+
+static void
+worker_thread (void *w_) 
+{
+  struct worker *w = w_;
+
+  w->work = do_work (w->start, w->end);
+  sema_up (w->done);
+}
+
+/* Waits for tick START, then returns the number of loop
+   iterations run before tick END. */
+static long long
+do_work (int64_t start, int64_t end) 
+{
+  long long work = 0;
+
+  while (timer_ticks () < start)
+    continue;
+  while (timer_ticks () < end)
+    work++;
+  return work;
+}
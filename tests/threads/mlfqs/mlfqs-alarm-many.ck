@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-alarm-many) begin
+(mlfqs-alarm-many) Creating 2000 threads to sleep 2 times each.
+(mlfqs-alarm-many) 4000 wake-ups, 0 early.
+(mlfqs-alarm-many) end
+EOF
+pass;
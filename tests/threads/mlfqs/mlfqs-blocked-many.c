@@ -0,0 +1,172 @@
+/* Checks that recent_cpu and priority come out the same for
+   blocked threads as if every thread were recomputed at every
+   second.
+
+   The main thread creates 500 threads over 5 seconds, each with
+   a different nice value, which block on a semaphore right
+   away.  While they are blocked the main thread spins, so that
+   the load average keeps changing, and records the recent_cpu
+   decay factor of each second.  After 3 more seconds it
+   recomputes each blocked thread's recent_cpu and priority by
+   the formulas, one second at a time, and compares them with
+   what the kernel reports. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of threads created per second. */
+#define BATCH_CNT 100
+
+/* Number of seconds over which threads are created. */
+#define ROUND_CNT 5
+
+/* Number of seconds to wait after creating the last thread. */
+#define QUIET_CNT 3
+
+#define THREAD_CNT (BATCH_CNT * ROUND_CNT)
+
+struct blocked_thread
+  {
+    struct thread *thread;      /* The thread. */
+    int nice;                   /* Its nice value. */
+    int recent_cpu;             /* recent_cpu just before blocking. */
+    int64_t epoch;              /* Second in which it blocked. */
+    struct semaphore sema;      /* Semaphore it blocks on. */
+  };
+
+static struct blocked_thread threads[THREAD_CNT];
+static struct semaphore done_sema;
+
+/* Decay factor of each second since FIRST_EPOCH. */
+static int decay[ROUND_CNT + QUIET_CNT + 1];
+static int64_t first_epoch, last_epoch;
+
+static thread_func blocked_thread;
+static void wait_epoch (void);
+static int expected_priority (int recent_cpu, int nice);
+
+void
+test_mlfqs_blocked_many (void)
+{
+  int round, i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+  first_epoch = last_epoch = timer_ticks () / TIMER_FREQ;
+  wait_epoch ();
+
+  msg ("Creating %d threads over %d seconds.", THREAD_CNT, ROUND_CNT);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      for (i = round * BATCH_CNT; i < (round + 1) * BATCH_CNT; i++)
+        {
+          struct blocked_thread *b = &threads[i];
+          char name[20];
+
+          b->nice = i % 41 - 20;
+          sema_init (&b->sema, 0);
+          snprintf (name, sizeof name, "blocked %d", i);
+          thread_create (name, PRI_DEFAULT, blocked_thread, b);
+        }
+      wait_epoch ();
+    }
+  for (i = 0; i < QUIET_CNT; i++)
+    wait_epoch ();
+
+  intr_disable ();
+  if (timer_ticks () / TIMER_FREQ != last_epoch)
+    fail ("took too long to check threads");
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct blocked_thread *b = &threads[i];
+      int recent_cpu = b->recent_cpu;
+      int priority;
+      int64_t e;
+
+      for (e = b->epoch + 1; e <= last_epoch; e++)
+        recent_cpu = add_x_and_n (mul_x_by_y (decay[e - first_epoch],
+                                              recent_cpu), b->nice);
+      priority = expected_priority (recent_cpu, b->nice);
+
+      thread_mlfqs_update (b->thread);
+      if (b->thread->recent_cpu != recent_cpu)
+        fail ("thread %d: recent_cpu is %d, should be %d",
+              i, b->thread->recent_cpu, recent_cpu);
+      if (b->thread->priority != priority)
+        fail ("thread %d: priority is %d, should be %d",
+              i, b->thread->priority, priority);
+    }
+  intr_enable ();
+  msg ("Checked recent_cpu and priority of %d blocked threads.",
+       THREAD_CNT);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&threads[i].sema);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done_sema);
+}
+
+/* Sets its nice value, records its recent_cpu, and blocks until
+   the main thread is done checking. */
+static void
+blocked_thread (void *b_)
+{
+  struct blocked_thread *b = b_;
+  enum intr_level old_level;
+
+  thread_set_nice (b->nice);
+
+  old_level = intr_disable ();
+  b->thread = thread_current ();
+  b->recent_cpu = thread_current ()->recent_cpu;
+  b->epoch = timer_ticks () / TIMER_FREQ;
+  sema_down (&b->sema);
+  intr_set_level (old_level);
+
+  sema_up (&done_sema);
+}
+
+/* Spins until the start of the next second, and records the
+   recent_cpu decay factor computed from the load average at
+   that point. */
+static void
+wait_epoch (void)
+{
+  int64_t epoch = ++last_epoch;
+  enum intr_level old_level;
+  int load_avg;
+
+  if (timer_ticks () / TIMER_FREQ >= epoch)
+    fail ("missed the start of second %"PRId64, epoch);
+  while (timer_ticks () / TIMER_FREQ < epoch)
+    continue;
+
+  old_level = intr_disable ();
+  load_avg = LOAD_AVG;
+  intr_set_level (old_level);
+  decay[epoch - first_epoch] = div_x_by_y (mul_x_by_n (load_avg, 2),
+                                           add_x_and_n (mul_x_by_n (load_avg, 2), 1));
+}
+
+/* Returns the priority the MLFQS formula gives for RECENT_CPU
+   and NICE. */
+static int
+expected_priority (int recent_cpu, int nice)
+{
+  int priority = convert_x_to_int_round_to_nearest (
+    sub_n_from_x (sub_y_from_x (convert_n_to_fp (PRI_MAX),
+                                div_x_by_n (recent_cpu, 4)), 2 * nice));
+
+  if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  else if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  return priority;
+}
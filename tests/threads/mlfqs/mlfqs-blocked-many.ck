@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-blocked-many) begin
+(mlfqs-blocked-many) Creating 500 threads over 5 seconds.
+(mlfqs-blocked-many) Checked recent_cpu and priority of 500 blocked threads.
+(mlfqs-blocked-many) end
+EOF
+pass;
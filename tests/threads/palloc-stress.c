@@ -0,0 +1,103 @@
+/* Page allocator stress benchmark.  Interleaves single-page and
+   multi-page allocations of varying sizes from the kernel pool,
+   freeing about half of them as it goes so that the pool is
+   fragmented, then frees the rest.  Reports the average latency
+   of an allocation and of a free, and the largest free block
+   before, during and after.  The timings are only reported, for
+   comparing kernels; the test passes as long as every allocation
+   succeeds, the pages hold what was written to them, and the pool
+   ends up as it began. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Number of allocations, and the most that are live at once. */
+#define ROUND_CNT 4000
+#define SLOT_CNT 256
+
+/* Largest multi-page allocation, in pages. */
+#define MAX_PAGES 17
+
+struct slot
+  {
+    uint8_t *pages;
+    size_t page_cnt;
+  };
+
+static struct slot slots[SLOT_CNT];
+
+static void
+slot_free (struct slot *s, uint64_t *free_ns)
+{
+  uint64_t start;
+
+  if (s->pages == NULL)
+    return;
+  if (s->pages[0] != (uint8_t) s->page_cnt
+      || s->pages[(s->page_cnt - 1) * PGSIZE] != (uint8_t) s->page_cnt)
+    fail ("block of %zu pages was overwritten", s->page_cnt);
+  start = timer_now_ns ();
+  palloc_free_multiple (s->pages, s->page_cnt);
+  *free_ns += timer_now_ns () - start;
+  s->pages = NULL;
+}
+
+void
+test_palloc_stress (void)
+{
+  size_t free_before, free_after, largest_before, largest_mid, largest_after;
+  uint64_t alloc_ns = 0, free_ns = 0, start;
+  int alloc_cnt = 0, free_cnt = 0;
+  int i;
+
+  random_init (0);
+  free_before = palloc_count_free (0, &largest_before);
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+
+      if (s->pages != NULL)
+        {
+          slot_free (s, &free_ns);
+          free_cnt++;
+        }
+
+      /* Every other allocation is a single page. */
+      s->page_cnt = i % 2 == 0 ? 1 : 2 + random_ulong () % (MAX_PAGES - 1);
+      start = timer_now_ns ();
+      s->pages = palloc_get_multiple (0, s->page_cnt);
+      alloc_ns += timer_now_ns () - start;
+      alloc_cnt++;
+      if (s->pages == NULL)
+        fail ("allocation of %zu pages failed", s->page_cnt);
+      s->pages[0] = s->page_cnt;
+      s->pages[(s->page_cnt - 1) * PGSIZE] = s->page_cnt;
+    }
+
+  palloc_count_free (0, &largest_mid);
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      {
+        slot_free (&slots[i], &free_ns);
+        free_cnt++;
+      }
+  free_after = palloc_count_free (0, &largest_after);
+
+  msg ("%d allocations: %"PRIu64" ns each on average.",
+       alloc_cnt, alloc_ns / alloc_cnt);
+  msg ("%d frees: %"PRIu64" ns each on average.",
+       free_cnt, free_ns / free_cnt);
+  msg ("Largest free block: %zu pages before, %zu while fragmented, "
+       "%zu after.", largest_before, largest_mid, largest_after);
+  if (free_after != free_before)
+    fail ("%zu pages free before, but %zu after", free_before, free_after);
+  if (largest_after != largest_before)
+    fail ("freed pages were not merged back");
+  pass ();
+}
@@ -0,0 +1,69 @@
+/* Sleeps so that the idle thread can zero pages ahead of time,
+   then checks that PAL_ZERO allocations are served from those
+   pages, that every page handed out is zeroed, and that the idle
+   thread refills the pool after it has been drawn down. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 8
+
+static uint8_t *pages[PAGE_CNT];
+
+static bool
+page_is_zero (const uint8_t *page)
+{
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    if (page[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_palloc_zero (void)
+{
+  unsigned long long hits_before, hits_after, misses;
+  size_t ready;
+  int i;
+
+  if (palloc_zero_high < PAGE_CNT || palloc_zero_low >= palloc_zero_high)
+    fail ("watermarks too low for this test");
+
+  timer_sleep (10);
+  palloc_zero_counts (0, &ready, &hits_before, &misses);
+  msg ("Pre-zeroed pages after sleeping: %s.",
+       ready >= PAGE_CNT ? "enough" : "too few");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i] = palloc_get_page (PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("allocation %d failed", i);
+      if (!page_is_zero (pages[i]))
+        fail ("page %d is not zeroed", i);
+      memset (pages[i], 0x5a, PGSIZE);
+    }
+  palloc_zero_counts (0, &ready, &hits_after, &misses);
+  msg ("PAL_ZERO allocations served from the pool: %llu of %d.",
+       hits_after - hits_before, PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  /* Draw the pool down to its low watermark, then let the idle
+     thread refill it. */
+  while (ready > palloc_zero_low)
+    {
+      palloc_free_page (palloc_get_page (PAL_ZERO));
+      palloc_zero_counts (0, &ready, &hits_after, &misses);
+    }
+  timer_sleep (10);
+  palloc_zero_counts (0, &ready, &hits_after, &misses);
+  msg ("Pool refilled to its high watermark: %s.",
+       ready == palloc_zero_high ? "yes" : "no");
+}
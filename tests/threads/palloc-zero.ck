@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) Pre-zeroed pages after sleeping: enough.
+(palloc-zero) PAL_ZERO allocations served from the pool: 8 of 8.
+(palloc-zero) Pool refilled to its high watermark: yes.
+(palloc-zero) end
+EOF
+pass;
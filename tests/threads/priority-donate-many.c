@@ -0,0 +1,90 @@
+/* The main thread acquires eight locks, then creates 32 threads
+   of increasing priority, each of which blocks acquiring one of
+   the locks and thus donates its priority to the main thread.
+   The main thread then releases the locks one at a time and
+   checks after each release that it keeps exactly the highest
+   priority still donated through the locks it holds. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of locks held by the main thread. */
+#define LOCK_CNT 8
+
+/* Number of donating threads. */
+#define THREAD_CNT 32
+
+static thread_func donor_thread;
+
+static struct lock locks[LOCK_CNT];
+static int finished_cnt;
+
+/* Returns the lock that the donor of priority PRIORITY waits for. */
+static struct lock *
+donor_lock (int priority)
+{
+  return &locks[priority * 5 % LOCK_CNT];
+}
+
+void
+test_priority_donate_many (void)
+{
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      lock_init (&locks[i]);
+      lock_acquire (&locks[i]);
+    }
+
+  finished_cnt = 0;
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      int priority = PRI_DEFAULT + 1 + i;
+      char name[16];
+
+      snprintf (name, sizeof name, "donor %d", priority);
+      thread_create (name, priority, donor_thread, donor_lock (priority));
+      if (thread_get_priority () != priority)
+        fail ("main thread has priority %d after donor %d blocked",
+              thread_get_priority (), priority);
+    }
+  msg ("Main thread has received %d donations.", THREAD_CNT);
+
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      int expected = PRI_DEFAULT;
+
+      lock_release (&locks[i]);
+      for (j = PRI_DEFAULT + 1; j <= PRI_DEFAULT + THREAD_CNT; j++)
+        if (donor_lock (j) > &locks[i])
+          expected = j;
+      if (thread_get_priority () != expected)
+        fail ("main thread has priority %d after releasing lock %d, "
+              "expected %d", thread_get_priority (), i, expected);
+    }
+  msg ("Main thread kept the right priority after every release.");
+
+  if (finished_cnt != THREAD_CNT)
+    fail ("only %d of %d donors finished", finished_cnt, THREAD_CNT);
+  msg ("All donors finished.");
+}
+
+static void
+donor_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+  finished_cnt++;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-many) begin
+(priority-donate-many) Main thread has received 32 donations.
+(priority-donate-many) Main thread kept the right priority after every release.
+(priority-donate-many) All donors finished.
+(priority-donate-many) end
+EOF
+pass;
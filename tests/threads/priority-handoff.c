@@ -0,0 +1,90 @@
+/* Checks that sema_up() and lock_release() hand the CPU straight
+   to a woken thread of equal or higher priority, ahead of other
+   ready threads of the same priority, and that waking a thread
+   of lower priority does not. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func sema_thread;
+static thread_func lock_thread;
+static thread_func low_thread;
+static thread_func bystander_thread;
+
+static struct semaphore sema;
+static struct semaphore done;
+static struct lock lock;
+
+void
+test_priority_handoff (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  sema_init (&done, 0);
+  lock_init (&lock);
+
+  /* Waking a thread of equal priority. */
+  thread_create ("sema", PRI_DEFAULT, sema_thread, NULL);
+  thread_yield ();
+  thread_create ("bystander 1", PRI_DEFAULT, bystander_thread, NULL);
+  msg ("Upping the semaphore.");
+  sema_up (&sema);
+  msg ("Main thread runs again.");
+
+  /* Releasing a lock to a thread of equal priority. */
+  lock_acquire (&lock);
+  thread_create ("lock", PRI_DEFAULT, lock_thread, NULL);
+  thread_yield ();
+  thread_create ("bystander 2", PRI_DEFAULT, bystander_thread, NULL);
+  msg ("Releasing the lock.");
+  lock_release (&lock);
+  msg ("Main thread runs again.");
+
+  /* Waking a thread of lower priority. */
+  thread_create ("low", PRI_DEFAULT, low_thread, NULL);
+  thread_yield ();
+  thread_set_priority (PRI_DEFAULT + 1);
+  msg ("Upping the semaphore.");
+  sema_up (&sema);
+  msg ("Main thread keeps running.");
+  sema_down (&done);
+  thread_set_priority (PRI_DEFAULT);
+  msg ("Main thread finished.");
+}
+
+static void
+sema_thread (void *aux UNUSED)
+{
+  sema_down (&sema);
+  msg ("Thread sema woke up.");
+}
+
+static void
+lock_thread (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  msg ("Thread lock acquired the lock.");
+  lock_release (&lock);
+}
+
+static void
+low_thread (void *aux UNUSED)
+{
+  sema_down (&sema);
+  msg ("Thread low woke up.");
+  sema_up (&done);
+}
+
+static void
+bystander_thread (void *aux UNUSED)
+{
+  msg ("Thread %s runs.", thread_name ());
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-handoff) begin
+(priority-handoff) Upping the semaphore.
+(priority-handoff) Thread sema woke up.
+(priority-handoff) Thread bystander 1 runs.
+(priority-handoff) Main thread runs again.
+(priority-handoff) Releasing the lock.
+(priority-handoff) Thread lock acquired the lock.
+(priority-handoff) Thread bystander 2 runs.
+(priority-handoff) Main thread runs again.
+(priority-handoff) Upping the semaphore.
+(priority-handoff) Main thread keeps running.
+(priority-handoff) Thread low woke up.
+(priority-handoff) Main thread finished.
+(priority-handoff) end
+EOF
+pass;
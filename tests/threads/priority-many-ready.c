@@ -0,0 +1,127 @@
+/* Forks hundreds of lower-priority threads onto the run queue
+   and checks that the scheduler still picks the right thread
+   every time.  Between rounds of forking, the main thread and an
+   equal-priority partner yield back and forth, and must strictly
+   alternate however many threads are waiting behind them.  At
+   the end the main thread drops to the lowest priority, and the
+   forked threads must run highest priority first, in the order
+   they were created within each priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of lower-priority threads to fork per round. */
+#define FORK_CNT 128
+
+/* Number of fork rounds. */
+#define ROUND_CNT 3
+
+/* Number of times each of the main thread and the partner yields
+   per round. */
+#define SWITCH_CNT 200
+
+#define THREAD_CNT (FORK_CNT * ROUND_CNT)
+
+static thread_func partner_thread;
+static thread_func ready_thread;
+static void take_turn (int me);
+
+static volatile bool partner_done;
+static volatile int turn;
+static struct semaphore partner_sema;
+
+/* Indexes of the forked threads, in the order they ran. */
+static int run_order[THREAD_CNT];
+static int run_cnt;
+
+static int
+ready_priority (int i)
+{
+  return PRI_MIN + i % (PRI_DEFAULT - PRI_MIN);
+}
+
+void
+test_priority_many_ready (void)
+{
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&partner_sema, 0);
+  partner_done = false;
+  turn = 0;
+  thread_create ("partner", PRI_DEFAULT, partner_thread, NULL);
+
+  for (round = 1; round <= ROUND_CNT; round++)
+    {
+      for (i = (round - 1) * FORK_CNT; i < round * FORK_CNT; i++)
+        {
+          char name[20];
+          snprintf (name, sizeof name, "ready %d", i);
+          thread_create (name, ready_priority (i), ready_thread,
+                         (void *) (intptr_t) i);
+        }
+
+      for (i = 0; i < SWITCH_CNT; i++)
+        take_turn (0);
+      msg ("%d ready threads: main and partner alternated %d times.",
+           round * FORK_CNT, 2 * SWITCH_CNT);
+    }
+
+  /* Let the partner finish, then let the ready threads run. */
+  partner_done = true;
+  sema_down (&partner_sema);
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (run_cnt != THREAD_CNT)
+    fail ("only %d of %d ready threads ran", run_cnt, THREAD_CNT);
+  for (i = 1; i < THREAD_CNT; i++)
+    {
+      int a = run_order[i - 1], b = run_order[i];
+      if (ready_priority (a) < ready_priority (b)
+          || (ready_priority (a) == ready_priority (b) && a > b))
+        fail ("\"ready %d\" (priority %d) ran before \"ready %d\" "
+              "(priority %d)", a, ready_priority (a), b, ready_priority (b));
+    }
+  msg ("%d ready threads ran by priority, oldest first within each.",
+       THREAD_CNT);
+}
+
+/* Checks that it is the turn of ME (0 for the main thread, 1 for
+   the partner), passes the turn on, and yields.  Interrupts stay
+   off from the check to the switch, so that a time slice running
+   out in between cannot let the other thread run twice. */
+static void
+take_turn (int me)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (turn % 2 != me)
+    fail ("%s ran out of turn", me ? "partner" : "main");
+  turn++;
+  thread_yield ();
+  intr_set_level (old_level);
+}
+
+/* Takes turns with the main thread until told to stop. */
+static void
+partner_thread (void *aux UNUSED)
+{
+  while (!partner_done)
+    take_turn (1);
+  sema_up (&partner_sema);
+}
+
+/* Records that it ran.  Forked threads only get to run once the
+   main thread lowers its priority. */
+static void
+ready_thread (void *i)
+{
+  run_order[run_cnt++] = (intptr_t) i;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-many-ready) begin
+(priority-many-ready) 128 ready threads: main and partner alternated 400 times.
+(priority-many-ready) 256 ready threads: main and partner alternated 400 times.
+(priority-many-ready) 384 ready threads: main and partner alternated 400 times.
+(priority-many-ready) 384 ready threads ran by priority, oldest first within each.
+(priority-many-ready) end
+EOF
+pass;
@@ -0,0 +1,101 @@
+/* Checks that a thread in an RCU read-side critical section is
+   not preempted by a higher-priority thread until the section
+   ends, that an element removed from a list with
+   list_remove_rcu() still leads a reader standing on it back into
+   the list, and that call_rcu() callbacks run once
+   rcu_barrier() returns. */
+
+#include <list.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/rcu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ITEM_CNT 3
+
+struct item
+  {
+    struct list_elem elem;
+    struct rcu_head rcu;
+    int value;
+    bool freed;
+  };
+
+static thread_func high_thread;
+static rcu_func free_item;
+
+static struct item items[ITEM_CNT];
+static bool high_ran;
+
+void
+test_rcu (void)
+{
+  struct list list;
+  struct list_elem *e;
+  bool ran_in_section;
+  int sum, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Preemption is put off until the reader is done. */
+  rcu_read_lock ();
+  thread_create ("high", PRI_DEFAULT + 1, high_thread, NULL);
+  ran_in_section = high_ran;
+  rcu_read_unlock ();
+  msg ("High-priority thread %s in the read-side section.",
+       ran_in_section ? "ran" : "did not run");
+  msg ("High-priority thread %s after it.",
+       high_ran ? "ran" : "did not run");
+
+  /* A reader standing on a removed element. */
+  list_init (&list);
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      items[i].value = i + 1;
+      items[i].freed = false;
+      list_push_back_rcu (&list, &items[i].elem);
+    }
+  sum = 0;
+  rcu_read_lock ();
+  for (e = list_begin_rcu (&list); e != list_end (&list);
+       e = list_next_rcu (e))
+    {
+      struct item *item = list_entry (e, struct item, elem);
+      sum += item->value;
+      if (item == &items[1])
+        {
+          list_remove_rcu (&item->elem);
+          call_rcu (&item->rcu, free_item);
+        }
+    }
+  ran_in_section = items[1].freed;
+  rcu_read_unlock ();
+  msg ("Sum of the values read: %d.", sum);
+  msg ("Callback %s in the read-side section.",
+       ran_in_section ? "ran" : "did not run");
+
+  rcu_barrier ();
+  msg ("Callback %s after rcu_barrier().",
+       items[1].freed ? "ran" : "did not run");
+
+  sum = 0;
+  synchronize_rcu ();
+  for (e = list_begin (&list); e != list_end (&list); e = list_next (e))
+    sum += list_entry (e, struct item, elem)->value;
+  msg ("Sum of the values left: %d.", sum);
+}
+
+static void
+high_thread (void *aux UNUSED)
+{
+  high_ran = true;
+}
+
+static void
+free_item (struct rcu_head *head)
+{
+  rcu_entry (head, struct item, rcu)->freed = true;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rcu) begin
+(rcu) High-priority thread did not run in the read-side section.
+(rcu) High-priority thread ran after it.
+(rcu) Sum of the values read: 6.
+(rcu) Callback did not run in the read-side section.
+(rcu) Callback ran after rcu_barrier().
+(rcu) Sum of the values left: 4.
+(rcu) end
+EOF
+pass;
@@ -0,0 +1,95 @@
+/* Checks admission control for SCHED_DEADLINE reservations.
+   Reservations may add up to at most 95% of the CPU, so with 50%
+   and 40% already reserved another 10% must be refused and 4%
+   admitted, and the 10% must be admitted once the 50% is given
+   back.  Reservations whose runtime, deadline and period are out
+   of order must be refused too. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Period of every reservation, in ns. */
+#define PERIOD (NSEC_PER_SEC / 10)
+
+struct holder
+  {
+    const char *name;           /* Thread name. */
+    int percent;                /* Share of the CPU to reserve. */
+    bool admitted;              /* Whether it was admitted. */
+    struct semaphore reserved;  /* Upped after trying to reserve. */
+    struct semaphore release;   /* Upped to give it back. */
+  };
+
+static thread_func holder_thread;
+static void reserve (struct holder *, const char *name, int percent);
+static void release (struct holder *);
+
+void
+test_rt_edf_admission (void) 
+{
+  struct holder a, b, c, d, e;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  reserve (&a, "a", 50);
+  reserve (&b, "b", 40);
+  reserve (&c, "c", 10);
+  reserve (&d, "d", 4);
+
+  if (thread_set_deadline (PERIOD / 2, PERIOD / 4, PERIOD))
+    fail ("reservation with runtime > deadline admitted");
+  if (thread_set_deadline (PERIOD / 4, PERIOD, PERIOD / 2))
+    fail ("reservation with deadline > period admitted");
+  if (thread_set_deadline (0, PERIOD, PERIOD))
+    fail ("reservation with zero runtime admitted");
+  msg ("Invalid reservations refused.");
+
+  release (&a);
+  reserve (&e, "c again", 10);
+
+  release (&b);
+  release (&c);
+  release (&d);
+  release (&e);
+}
+
+/* Starts a thread named NAME that tries to reserve PERCENT% of
+   the CPU, reports whether it got it, and then holds on to it
+   until released with release(). */
+static void
+reserve (struct holder *h, const char *name, int percent) 
+{
+  h->name = name;
+  h->percent = percent;
+  sema_init (&h->reserved, 0);
+  sema_init (&h->release, 0);
+  thread_create (name, PRI_MAX, holder_thread, h);
+  sema_down (&h->reserved);
+  msg ("%s: %d%% %s.", name, percent, h->admitted ? "admitted" : "refused");
+}
+
+/* Makes H's thread give back its reservation and exit. */
+static void
+release (struct holder *h) 
+{
+  sema_up (&h->release);
+  sema_down (&h->reserved);
+  msg ("%s: released.", h->name);
+}
+
+static void
+holder_thread (void *h_) 
+{
+  struct holder *h = h_;
+
+  h->admitted = thread_set_deadline (PERIOD / 100 * h->percent,
+                                     PERIOD, PERIOD);
+  sema_up (&h->reserved);
+  sema_down (&h->release);
+  thread_set_normal ();
+  sema_up (&h->reserved);
+}
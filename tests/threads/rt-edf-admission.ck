@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-edf-admission) begin
+(rt-edf-admission) a: 50% admitted.
+(rt-edf-admission) b: 40% admitted.
+(rt-edf-admission) c: 10% refused.
+(rt-edf-admission) d: 4% admitted.
+(rt-edf-admission) Invalid reservations refused.
+(rt-edf-admission) a: released.
+(rt-edf-admission) c again: 10% admitted.
+(rt-edf-admission) b: released.
+(rt-edf-admission) c: released.
+(rt-edf-admission) d: released.
+(rt-edf-admission) c again: released.
+(rt-edf-admission) end
+EOF
+pass;
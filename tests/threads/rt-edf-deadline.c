@@ -0,0 +1,152 @@
+/* Runs three periodic SCHED_DEADLINE threads with different
+   periods and deadlines next to a normal thread that never
+   blocks, and checks that every job of every one of them finishes
+   by its deadline, and that each of them gets to run once in
+   every one of its periods. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of jobs each periodic thread runs. */
+#define JOB_CNT 20
+
+/* Milliseconds of work in each job. */
+#define WORK_MS 3
+
+/* Nanoseconds per millisecond. */
+#define NSEC_PER_MSEC (NSEC_PER_SEC / 1000)
+
+struct task
+  {
+    int runtime_ms;             /* Budget per period. */
+    int deadline_ms;            /* Relative deadline. */
+    int period_ms;              /* Period. */
+    int misses;                 /* Jobs that missed their deadline. */
+    uint64_t start;             /* Start of the first job. */
+    uint64_t end;               /* End of the last job. */
+  };
+
+static struct task tasks[] =
+  {
+    {.runtime_ms = 10, .deadline_ms = 30, .period_ms = 50},
+    {.runtime_ms = 10, .deadline_ms = 40, .period_ms = 75},
+    {.runtime_ms = 10, .deadline_ms = 60, .period_ms = 100},
+  };
+
+#define TASK_CNT ((int) (sizeof tasks / sizeof *tasks))
+
+static thread_func task_thread;
+static thread_func hog_thread;
+static void do_work (long long loops);
+
+static long long loops_per_ms;
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_rt_edf_deadline (void) 
+{
+  uint64_t elapsed;
+  long long loops;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Find out how many iterations of do_work() take a
+     millisecond. */
+  for (loops = 1 << 16; ; loops *= 2)
+    {
+      uint64_t start = timer_now_ns ();
+      do_work (loops);
+      elapsed = timer_now_ns () - start;
+      if (elapsed >= 50 * NSEC_PER_MSEC)
+        break;
+    }
+  loops_per_ms = loops * NSEC_PER_MSEC / elapsed;
+
+  sema_init (&done, 0);
+  stop = false;
+  thread_create ("hog", PRI_DEFAULT, hog_thread, NULL);
+
+  msg ("Running %d periodic threads next to a CPU hog.", TASK_CNT);
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "task %d", i);
+      thread_create (name, PRI_DEFAULT, task_thread, &tasks[i]);
+    }
+  for (i = 0; i < TASK_CNT; i++)
+    sema_down (&done);
+  stop = true;
+  sema_down (&done);
+
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      struct task *t = &tasks[i];
+      uint64_t period = (uint64_t) t->period_ms * NSEC_PER_MSEC;
+
+      elapsed = t->end - t->start;
+
+      if (t->misses != 0)
+        fail ("task %d missed %d of %d deadlines", i, t->misses, JOB_CNT);
+      if (elapsed < (JOB_CNT - 1) * period)
+        fail ("task %d ran %d jobs in only %llu ms", i, JOB_CNT,
+              (unsigned long long) (elapsed / NSEC_PER_MSEC));
+      if (elapsed > JOB_CNT * period)
+        fail ("task %d took %llu ms for %d jobs", i,
+              (unsigned long long) (elapsed / NSEC_PER_MSEC), JOB_CNT);
+      msg ("Task %d met all %d deadlines.", i, JOB_CNT);
+    }
+}
+
+/* Runs JOB_CNT jobs, one per period, and counts the ones that
+   finish after their deadline. */
+static void
+task_thread (void *t_) 
+{
+  struct task *t = t_;
+  int i;
+
+  if (!thread_set_deadline ((uint64_t) t->runtime_ms * NSEC_PER_MSEC,
+                            (uint64_t) t->deadline_ms * NSEC_PER_MSEC,
+                            (uint64_t) t->period_ms * NSEC_PER_MSEC))
+    fail ("reservation (%d, %d, %d) refused",
+          t->runtime_ms, t->deadline_ms, t->period_ms);
+
+  t->misses = 0;
+  t->start = timer_now_ns ();
+  for (i = 0; i < JOB_CNT; i++)
+    {
+      do_work (WORK_MS * loops_per_ms);
+      t->end = timer_now_ns ();
+      if (t->end > thread_current ()->dl.abs_deadline)
+        t->misses++;
+      thread_yield_period ();
+    }
+  thread_set_normal ();
+  sema_up (&done);
+}
+
+/* Spins until told to stop. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  sema_up (&done);
+}
+
+/* Runs LOOPS iterations of an empty loop. */
+static void
+do_work (long long loops) 
+{
+  volatile long long i;
+
+  for (i = 0; i < loops; i++)
+    continue;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-edf-deadline) begin
+(rt-edf-deadline) Running 3 periodic threads next to a CPU hog.
+(rt-edf-deadline) Task 0 met all 20 deadlines.
+(rt-edf-deadline) Task 1 met all 20 deadlines.
+(rt-edf-deadline) Task 2 met all 20 deadlines.
+(rt-edf-deadline) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Checks that a SCHED_FIFO thread that never blocks cannot starve
+   the system.  The main thread spins at the highest real-time
+   priority for 3 seconds while a normal thread counts the ticks
+   in which it gets to run.  Real-time threads may use at most 95%
+   of each second while other threads are ready, so the normal
+   thread must run for about 5 ticks a second, but not much more
+   than that. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks to spin for. */
+#define SPIN_TICKS (3 * TIMER_FREQ)
+
+static thread_func counter_thread;
+static volatile bool stop;
+static volatile int counter_ticks;
+static struct semaphore done;
+
+void
+test_rt_fifo_throttle (void) 
+{
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  stop = false;
+  counter_ticks = 0;
+  thread_create ("counter", PRI_DEFAULT, counter_thread, NULL);
+
+  if (!thread_set_fifo (RT_PRI_MAX))
+    fail ("thread_set_fifo (RT_PRI_MAX) failed");
+  msg ("Spinning as a SCHED_FIFO thread for %d ticks.", SPIN_TICKS);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+  stop = true;
+  thread_set_normal ();
+  sema_down (&done);
+
+  if (counter_ticks < SPIN_TICKS / TIMER_FREQ * 2)
+    fail ("normal thread ran for only %d ticks", counter_ticks);
+  msg ("Normal thread ran while the SCHED_FIFO thread spun.");
+  if (counter_ticks > SPIN_TICKS / 4)
+    fail ("normal thread ran for %d ticks", counter_ticks);
+  msg ("SCHED_FIFO thread got most of the CPU.");
+}
+
+/* Counts the ticks in which it runs until told to stop. */
+static void
+counter_thread (void *aux UNUSED) 
+{
+  int64_t last = 0;
+
+  while (!stop)
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        counter_ticks++;
+      last = now;
+    }
+  sema_up (&done);
+}
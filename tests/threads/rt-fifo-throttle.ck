@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-fifo-throttle) begin
+(rt-fifo-throttle) Spinning as a SCHED_FIFO thread for 300 ticks.
+(rt-fifo-throttle) Normal thread ran while the SCHED_FIFO thread spun.
+(rt-fifo-throttle) SCHED_FIFO thread got most of the CPU.
+(rt-fifo-throttle) end
+EOF
+pass;
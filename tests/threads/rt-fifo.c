@@ -0,0 +1,97 @@
+/* Checks SCHED_FIFO scheduling.  Real-time threads must run
+   before every normal thread, whatever its priority, in order of
+   real-time priority, first-in first-out and without time slices
+   among threads of equal real-time priority, and a real-time
+   thread must preempt a lower one as soon as it is woken up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks each real-time thread spins for. */
+#define SPIN_TICKS 3
+
+struct fifo_thread
+  {
+    const char *name;           /* Thread name. */
+    int rt_priority;            /* Real-time priority, or 0 for normal. */
+    struct semaphore start;     /* Upped to let the thread go. */
+  };
+
+static struct fifo_thread threads[] =
+  {
+    {.name = "normal", .rt_priority = 0},
+    {.name = "fifo 20", .rt_priority = 20},
+    {.name = "fifo 30a", .rt_priority = 30},
+    {.name = "fifo 30b", .rt_priority = 30},
+    {.name = "fifo 40", .rt_priority = 40},
+    {.name = "fifo 60", .rt_priority = 60},
+  };
+
+#define THREAD_CNT ((int) (sizeof threads / sizeof *threads))
+
+static thread_func fifo_thread;
+static struct semaphore done;
+
+void
+test_rt_fifo (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Each thread runs right away, at PRI_MAX, and makes itself a
+     real-time thread before waiting to be let go. */
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      sema_init (&threads[i].start, 0);
+      thread_create (threads[i].name, PRI_MAX, fifo_thread, &threads[i]);
+    }
+
+  /* No thread preempts us while we wake up all but the last. */
+  if (!thread_set_fifo (50))
+    fail ("thread_set_fifo (50) failed");
+  msg ("Main thread is SCHED_FIFO at priority 50.");
+  for (i = 0; i < THREAD_CNT - 1; i++)
+    sema_up (&threads[i].start);
+  msg ("Woke up every thread.");
+
+  /* The last one preempts us at once. */
+  msg ("Waking up %s.", threads[THREAD_CNT - 1].name);
+  sema_up (&threads[THREAD_CNT - 1].start);
+  msg ("Back in main.");
+
+  /* Now everyone else runs before us. */
+  thread_set_normal ();
+  msg ("Main thread is SCHED_NORMAL again.");
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+}
+
+static void
+fifo_thread (void *t_) 
+{
+  struct fifo_thread *t = t_;
+  int64_t start;
+
+  if (t->rt_priority != 0 && !thread_set_fifo (t->rt_priority))
+    fail ("thread_set_fifo (%d) failed", t->rt_priority);
+  sema_down (&t->start);
+
+  if (t->rt_priority == 0)
+    msg ("%s runs.", t->name);
+  else
+    {
+      msg ("%s starts.", t->name);
+      start = timer_ticks ();
+      while (timer_elapsed (start) < SPIN_TICKS)
+        continue;
+      msg ("%s done.", t->name);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-fifo) begin
+(rt-fifo) Main thread is SCHED_FIFO at priority 50.
+(rt-fifo) Woke up every thread.
+(rt-fifo) Waking up fifo 60.
+(rt-fifo) fifo 60 starts.
+(rt-fifo) fifo 60 done.
+(rt-fifo) Back in main.
+(rt-fifo) fifo 40 starts.
+(rt-fifo) fifo 40 done.
+(rt-fifo) fifo 30a starts.
+(rt-fifo) fifo 30a done.
+(rt-fifo) fifo 30b starts.
+(rt-fifo) fifo 30b done.
+(rt-fifo) fifo 20 starts.
+(rt-fifo) fifo 20 done.
+(rt-fifo) normal runs.
+(rt-fifo) Main thread is SCHED_NORMAL again.
+(rt-fifo) end
+EOF
+pass;
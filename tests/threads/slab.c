@@ -0,0 +1,93 @@
+/* Allocates enough objects from an object cache with a
+   constructor to fill several slabs, and checks that each object
+   is distinct, was constructed once, and keeps its constructed
+   state across a free and a new allocation.  Then frees them all
+   and checks that shrinking the cache gives its empty slabs back
+   to the page allocator. */
+
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 200
+
+/* A 40-byte object, which malloc() would round up to 64. */
+struct obj
+  {
+    int magic;
+    int ctor_cnt;
+    char payload[32];
+  };
+
+#define OBJ_MAGIC 0x0b7ec7ed
+
+/* Pages malloc() would take for them, at 63 64-byte blocks per
+   page. */
+#define MALLOC_PAGES DIV_ROUND_UP (OBJ_CNT, PGSIZE / 64 - 1)
+
+static kmem_ctor obj_ctor;
+
+static struct obj *objs[OBJ_CNT];
+static int ctor_cnt;
+
+void
+test_slab (void)
+{
+  struct kmem_cache *cache;
+  size_t free_before, free_full, free_after, shrunk;
+  struct obj *again;
+  int i, j;
+
+  cache = kmem_cache_create ("test", sizeof (struct obj), obj_ctor);
+  ASSERT (cache != NULL);
+
+  free_before = palloc_count_free (0, NULL);
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->ctor_cnt != 1)
+        fail ("object %d was not constructed exactly once", i);
+      memset (objs[i]->payload, i, sizeof objs[i]->payload);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    for (j = 0; j < (int) sizeof objs[i]->payload; j++)
+      if (objs[i]->payload[j] != (char) i)
+        fail ("object %d overlaps another", i);
+  free_full = palloc_count_free (0, NULL);
+  msg ("%d objects take %s pages than malloc() would.", OBJ_CNT,
+       free_before - free_full < MALLOC_PAGES ? "fewer" : "no fewer");
+
+  /* An object freed and allocated again keeps its state. */
+  kmem_cache_free (cache, objs[0]);
+  again = kmem_cache_alloc (cache);
+  msg ("Reallocated object is %s.",
+       again->magic == OBJ_MAGIC && again->ctor_cnt == 1
+       ? "still constructed" : "not constructed");
+  objs[0] = again;
+  msg ("Constructor calls: %s.",
+       ctor_cnt >= OBJ_CNT ? "one per slot" : "too few");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  shrunk = kmem_cache_shrink (cache);
+  free_after = palloc_count_free (0, NULL);
+  msg ("Shrinking %s pages.", shrunk > 0 ? "freed" : "did not free");
+  if (free_after != free_before)
+    fail ("%zu pages free before, but %zu after", free_before, free_after);
+}
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->ctor_cnt = obj->magic == OBJ_MAGIC ? obj->ctor_cnt + 1 : 1;
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
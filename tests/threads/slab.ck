@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) 200 objects take fewer pages than malloc() would.
+(slab) Reallocated object is still constructed.
+(slab) Constructor calls: one per slot.
+(slab) Shrinking freed pages.
+(slab) end
+EOF
+pass;
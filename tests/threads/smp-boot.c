@@ -0,0 +1,58 @@
+/* Boots with several CPUs (the test runs under `-smp 4') and
+   checks that the application processors came up and that threads
+   end up running on each of them.  The threads sleep most of the
+   time, so that the kernel is free often enough for the idle CPUs
+   to steal the threads that wake up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define ROUNDS 20
+
+static struct semaphore done;
+
+/* Bit I is set once some thread has run on CPU I. */
+static unsigned cpus_seen;
+
+static void
+smp_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      enum intr_level old_level = intr_disable ();
+      cpus_seen |= 1u << cpu_current ()->id;
+      intr_set_level (old_level);
+      timer_sleep (1);
+    }
+  sema_up (&done);
+}
+
+void
+test_smp_boot (void)
+{
+  int i;
+
+  msg ("%u CPUs online.", cpu_cnt);
+
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "smp %d", i);
+      thread_create (name, PRI_DEFAULT, smp_thread, NULL);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  if (cpus_seen != (1u << cpu_cnt) - 1)
+    fail ("threads ran only on CPUs %#x", cpus_seen);
+  msg ("Threads ran on every CPU.");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(smp-boot) begin
+(smp-boot) 4 CPUs online.
+(smp-boot) Threads ran on every CPU.
+(smp-boot) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Context-switch microbenchmark.  Two threads of equal priority
+   hand control back and forth over a pair of semaphores, so
+   every sema_up() is followed by a switch to the other thread,
+   and the time-stamp counter gives the average number of cycles
+   each switch takes.  The result is only reported, for comparing
+   kernels; the test passes as long as every round trip happens. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <intrinsic.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of round trips, each of which is two switches. */
+#define ROUND_TRIP_CNT 10000
+
+static thread_func pong;
+
+static struct semaphore ping_sema;
+static struct semaphore pong_sema;
+static struct semaphore done_sema;
+static int pong_cnt;
+
+void
+test_switch_pingpong (void)
+{
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&ping_sema, 0);
+  sema_init (&pong_sema, 0);
+  sema_init (&done_sema, 0);
+  pong_cnt = 0;
+  thread_create ("pong", PRI_DEFAULT, pong, NULL);
+
+  /* Let the partner get to its first sema_down(). */
+  sema_up (&pong_sema);
+  sema_down (&ping_sema);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_up (&pong_sema);
+      sema_down (&ping_sema);
+    }
+  cycles = rdtsc () - start;
+  sema_down (&done_sema);
+
+  msg ("%d round trips: %"PRIu64" cycles per switch.",
+          ROUND_TRIP_CNT, cycles / (2 * ROUND_TRIP_CNT));
+  if (pong_cnt != ROUND_TRIP_CNT + 1)
+    fail ("partner woke up %d times, expected %d",
+          pong_cnt, ROUND_TRIP_CNT + 1);
+  pass ();
+}
+
+/* Answers every ping with a pong. */
+static void
+pong (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i <= ROUND_TRIP_CNT; i++)
+    {
+      sema_down (&pong_sema);
+      pong_cnt++;
+      sema_up (&ping_sema);
+    }
+  sema_up (&done_sema);
+}
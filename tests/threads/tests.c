@@ -17,6 +17,9 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-many", test_alarm_many},
+    {"alarm-tickless", test_alarm_tickless},
+    {"alarm-usleep", test_alarm_usleep},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -29,6 +32,22 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-donate-many", test_priority_donate_many},
+    {"priority-many-ready", test_priority_many_ready},
+    {"switch-pingpong", test_switch_pingpong},
+    {"rt-fifo", test_rt_fifo},
+    {"rt-fifo-throttle", test_rt_fifo_throttle},
+    {"rt-edf-deadline", test_rt_edf_deadline},
+    {"rt-edf-admission", test_rt_edf_admission},
+    {"priority-handoff", test_priority_handoff},
+    {"workqueue", test_workqueue},
+    {"rcu", test_rcu},
+    {"palloc-stress", test_palloc_stress},
+    {"slab", test_slab},
+    {"malloc-classes", test_malloc_classes},
+    {"palloc-zero", test_palloc_zero},
+    {"direct-map", test_direct_map},
+    {"smp-boot", test_smp_boot},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +57,13 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-alarm-many", test_mlfqs_alarm_many},
+    {"mlfqs-blocked-many", test_mlfqs_blocked_many},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"cfs-throughput", test_cfs_throughput},
   };
 
 static const char *test_name;
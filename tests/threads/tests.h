@@ -11,6 +11,9 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_many;
+extern test_func test_alarm_tickless;
+extern test_func test_alarm_usleep;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -23,6 +26,22 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_donate_many;
+extern test_func test_priority_many_ready;
+extern test_func test_switch_pingpong;
+extern test_func test_rt_fifo;
+extern test_func test_rt_fifo_throttle;
+extern test_func test_rt_edf_deadline;
+extern test_func test_rt_edf_admission;
+extern test_func test_priority_handoff;
+extern test_func test_workqueue;
+extern test_func test_rcu;
+extern test_func test_palloc_stress;
+extern test_func test_slab;
+extern test_func test_malloc_classes;
+extern test_func test_palloc_zero;
+extern test_func test_direct_map;
+extern test_func test_smp_boot;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +51,13 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_alarm_many;
+extern test_func test_mlfqs_blocked_many;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_cfs_throughput;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,101 @@
+/* Queues work on a workqueue of its own, several at once with
+   interrupts off and then after a delay, and checks that each
+   runs once, in order, in the queue's worker thread.  Also checks
+   that pending work cannot be queued twice, that a cancelled
+   delayed work does not run, and that flush_workqueue() waits for
+   the work. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define WORK_CNT 3
+
+static work_func record_work;
+static work_func record_delayed;
+
+static struct work works[WORK_CNT];
+static struct delayed_work dwork;
+
+static int order[WORK_CNT * 2];
+static int order_cnt;
+static bool in_worker = true;
+static int64_t ran_at;
+
+void
+test_workqueue (void)
+{
+  struct workqueue *wq;
+  enum intr_level old_level;
+  int64_t start;
+  bool queued, requeued;
+  int i;
+
+  wq = workqueue_create ("test", PRI_DEFAULT, 1);
+  ASSERT (wq != NULL);
+
+  /* Several works, queued together. */
+  for (i = 0; i < WORK_CNT; i++)
+    work_init (&works[i], record_work, (void *) (intptr_t) i);
+  old_level = intr_disable ();
+  queued = true;
+  for (i = 0; i < WORK_CNT; i++)
+    queued = queue_work (wq, &works[i]) && queued;
+  requeued = queue_work (wq, &works[0]);
+  intr_set_level (old_level);
+  if (!queued)
+    fail ("queue_work() refused idle work");
+  if (requeued)
+    fail ("queue_work() queued pending work twice");
+
+  msg ("Flushing the workqueue.");
+  flush_workqueue (wq);
+  for (i = 0; i < order_cnt; i++)
+    msg ("Work %d ran.", order[i]);
+  if (!in_worker)
+    fail ("work ran outside the worker thread");
+
+  /* Delayed work. */
+  delayed_work_init (&dwork, record_delayed, NULL);
+  start = timer_ticks ();
+  queue_delayed_work (wq, &dwork, 20);
+  timer_sleep (5);
+  flush_workqueue (wq);
+  msg ("Delayed work %s after 5 ticks.",
+       ran_at == 0 ? "has not run" : "already ran");
+  timer_sleep (30);
+  flush_workqueue (wq);
+  if (ran_at == 0)
+    fail ("delayed work did not run");
+  msg ("Delayed work ran after %s 20 ticks.",
+       ran_at - start >= 20 ? "at least" : "fewer than");
+
+  /* Cancelled delayed work. */
+  ran_at = 0;
+  queue_delayed_work (wq, &dwork, 20);
+  msg ("Cancelling delayed work: %s.",
+       cancel_delayed_work (&dwork) ? "cancelled" : "too late");
+  timer_sleep (30);
+  flush_workqueue (wq);
+  msg ("Cancelled delayed work %s.", ran_at == 0 ? "did not run" : "ran");
+}
+
+static void
+record_work (struct work *work)
+{
+  if (strcmp (thread_name (), "test/0"))
+    in_worker = false;
+  order[order_cnt++] = (intptr_t) work->aux;
+}
+
+static void
+record_delayed (struct work *work UNUSED)
+{
+  ran_at = timer_ticks ();
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Flushing the workqueue.
+(workqueue) Work 0 ran.
+(workqueue) Work 1 ran.
+(workqueue) Work 2 ran.
+(workqueue) Delayed work has not run after 5 ticks.
+(workqueue) Delayed work ran after at least 20 ticks.
+(workqueue) Cancelling delayed work: cancelled.
+(workqueue) Cancelled delayed work did not run.
+(workqueue) end
+EOF
+pass;
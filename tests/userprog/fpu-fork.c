@@ -0,0 +1,48 @@
+/* Checks that a child process starts with a copy of its parent's
+   SSE registers, and that the two do not see each other's
+   changes to them afterward. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PARENT_VALUE 0x0123456789abcdefULL
+#define CHILD_VALUE 0xfedcba9876543210ULL
+
+/* This code is built without SSE, so the compiler itself never
+   touches %xmm0. */
+static void
+set_xmm0 (uint64_t value)
+{
+  asm volatile ("movq %0, %%xmm0" : : "r" (value));
+}
+
+static uint64_t
+get_xmm0 (void)
+{
+  uint64_t value;
+  asm volatile ("movq %%xmm0, %0" : "=r" (value));
+  return value;
+}
+
+void
+test_main (void) 
+{
+  int pid;
+
+  set_xmm0 (PARENT_VALUE);
+  if ((pid = fork ("child"))){
+    int status = wait (pid);
+    msg ("Parent: child exit status is %d", status);
+    if (get_xmm0 () != PARENT_VALUE)
+      fail ("parent's xmm0 changed");
+    msg ("Parent: xmm0 kept its value");
+  } else {
+    if (get_xmm0 () != PARENT_VALUE)
+      fail ("child did not inherit xmm0");
+    msg ("child inherited xmm0");
+    set_xmm0 (CHILD_VALUE);
+    exit (81);
+  }
+}
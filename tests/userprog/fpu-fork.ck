@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-fork) begin
+(fpu-fork) child inherited xmm0
+child: exit(81)
+(fpu-fork) Parent: child exit status is 81
+(fpu-fork) Parent: xmm0 kept its value
+(fpu-fork) end
+fpu-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Fills a 4 MB zero-initialized array, which covers at least one
+   2 MB-aligned run that the loader may map with a large page,
+   then forks and checks that the child gets its own copy of the
+   data. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define PAGE 4096
+
+static char buf[SIZE];
+
+/* The byte expected at offset OFS of BUF once it is filled. */
+static char
+pattern (size_t ofs)
+{
+  return (ofs / PAGE) ^ (ofs % 251);
+}
+
+/* Checks that every page of BUF holds the pattern, sampling the
+   first and last bytes of each page. */
+static void
+check_pattern (const char *who)
+{
+  size_t ofs;
+
+  for (ofs = 0; ofs < SIZE; ofs += PAGE)
+    if (buf[ofs] != pattern (ofs)
+        || buf[ofs + PAGE - 1] != pattern (ofs + PAGE - 1))
+      fail ("%s: wrong data at offset %zu", who, ofs);
+}
+
+void
+test_main (void)
+{
+  size_t ofs;
+  int pid;
+
+  for (ofs = 0; ofs < SIZE; ofs++)
+    if (buf[ofs] != 0)
+      fail ("byte %zu is not zero", ofs);
+  msg ("array is zeroed");
+
+  for (ofs = 0; ofs < SIZE; ofs++)
+    buf[ofs] = pattern (ofs);
+
+  if ((pid = fork ("child")))
+    {
+      int status = wait (pid);
+      if (status != 0)
+        fail ("child exited with status %d", status);
+      check_pattern ("parent");
+      msg ("parent's data unchanged");
+    }
+  else
+    {
+      check_pattern ("child");
+      msg ("child sees the parent's data");
+      for (ofs = 0; ofs < SIZE; ofs += PAGE)
+        buf[ofs] = ~buf[ofs];
+      exit (0);
+    }
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(large-bss) begin
+(large-bss) array is zeroed
+(large-bss) child sees the parent's data
+child: exit(0)
+(large-bss) parent's data unchanged
+(large-bss) end
+large-bss: exit(0)
+EOF
+pass;
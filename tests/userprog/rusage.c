@@ -0,0 +1,67 @@
+/* Checks the getrusage system call: the caller's user time
+   advances while it computes, writing a file counts written
+   sectors, the time of a child that exited is reported for
+   RUSAGE_CHILDREN, and any other request is refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void spin (struct rusage *);
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  int pid;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage (RUSAGE_SELF)");
+  spin (&after);
+  if (after.stime < before.stime || after.nvcsw < before.nvcsw)
+    fail ("usage went backward");
+
+  CHECK (create ("quux.dat", 0), "create quux.dat");
+  before = after;
+  CHECK (getrusage (RUSAGE_SELF, &after) == 0, "getrusage (RUSAGE_SELF)");
+  if (after.oublock <= before.oublock)
+    fail ("creating a file wrote no sectors");
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &before) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  if (before.utime != 0)
+    fail ("no child has exited yet, but children used %lld ns",
+          (long long) before.utime);
+  if ((pid = fork ("child")) == 0)
+    {
+      spin (&after);
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (getrusage (RUSAGE_CHILDREN, &after) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  if (after.utime == 0)
+    fail ("child's user time is missing");
+
+  CHECK (getrusage (1, &after) == -1, "getrusage (1) must fail");
+}
+
+/* Computes until the user time that getrusage() reports for the
+   caller advances, and stores the final report in RU. */
+static void
+spin (struct rusage *ru) 
+{
+  struct rusage start;
+  volatile int i;
+  int tries;
+
+  getrusage (RUSAGE_SELF, &start);
+  for (tries = 0; tries < 1000; tries++)
+    {
+      for (i = 0; i < 100000; i++)
+        continue;
+      getrusage (RUSAGE_SELF, ru);
+      if (ru->utime > start.utime)
+        return;
+    }
+  fail ("user time did not advance");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage) begin
+(rusage) getrusage (RUSAGE_SELF)
+(rusage) create quux.dat
+(rusage) getrusage (RUSAGE_SELF)
+(rusage) getrusage (RUSAGE_CHILDREN)
+child: exit(0)
+(rusage) wait for child
+(rusage) getrusage (RUSAGE_CHILDREN)
+(rusage) getrusage (1) must fail
+(rusage) end
+rusage: exit(0)
+EOF
+pass;
@@ -0,0 +1,156 @@
+/* Parallel merge sort benchmark, run under `-smp 4'.  Sorts the
+   same array twice: once in this process, and once by forking a
+   child per quarter of the array, each of which sorts its quarter
+   into a file, and merging the four files here.  Checks that both
+   give the same result and reports the speedup, which depends on
+   the machine and so is not checked. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ELEM_CNT (64 * 1024)
+#define CHILD_CNT 4
+#define CHUNK_CNT (ELEM_CNT / CHILD_CNT)
+
+static int data[ELEM_CNT];
+static int sorted[ELEM_CNT];
+static int merged[ELEM_CNT];
+static int tmp[ELEM_CNT];
+
+static uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Sorts the CNT elements of A, using SCRATCH as scratch space. */
+static void
+merge_sort (int *a, int *scratch, size_t cnt)
+{
+  size_t half = cnt / 2, i = 0, j = half, k = 0;
+
+  if (cnt < 2)
+    return;
+  merge_sort (a, scratch, half);
+  merge_sort (a + half, scratch, cnt - half);
+  while (i < half && j < cnt)
+    scratch[k++] = a[i] <= a[j] ? a[i++] : a[j++];
+  while (i < half)
+    scratch[k++] = a[i++];
+  while (j < cnt)
+    scratch[k++] = a[j++];
+  memcpy (a, scratch, cnt * sizeof *a);
+}
+
+static void
+chunk_name (char *name, int i)
+{
+  snprintf (name, 16, "chunk%d", i);
+}
+
+/* Sorts quarter I of DATA into file "chunkI" and exits. */
+static void
+sort_chunk (int i)
+{
+  char name[16];
+  int *chunk = data + i * CHUNK_CNT;
+  int fd;
+
+  merge_sort (chunk, tmp, CHUNK_CNT);
+  chunk_name (name, i);
+  if ((fd = open (name)) < 0)
+    fail ("open \"%s\"", name);
+  if (write (fd, chunk, sizeof *chunk * CHUNK_CNT)
+      != (int) (sizeof *chunk * CHUNK_CNT))
+    fail ("write \"%s\"", name);
+  close (fd);
+  exit (0);
+}
+
+/* Sorts DATA into MERGED with CHILD_CNT child processes. */
+static void
+parallel_sort (void)
+{
+  size_t pos[CHILD_CNT];
+  pid_t pids[CHILD_CNT];
+  char name[16];
+  int i, k;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      chunk_name (name, i);
+      if (!create (name, sizeof *data * CHUNK_CNT))
+        fail ("create \"%s\"", name);
+      if ((pids[i] = fork (name)) == 0)
+        sort_chunk (i);
+      if (pids[i] < 0)
+        fail ("fork \"%s\"", name);
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      int fd;
+
+      if (wait (pids[i]) != 0)
+        fail ("child %d failed", i);
+      chunk_name (name, i);
+      if ((fd = open (name)) < 0)
+        fail ("open \"%s\"", name);
+      if (read (fd, data + i * CHUNK_CNT, sizeof *data * CHUNK_CNT)
+          != (int) (sizeof *data * CHUNK_CNT))
+        fail ("read \"%s\"", name);
+      close (fd);
+      pos[i] = 0;
+    }
+
+  for (k = 0; k < ELEM_CNT; k++)
+    {
+      int min = -1;
+
+      for (i = 0; i < CHILD_CNT; i++)
+        if (pos[i] < CHUNK_CNT
+            && (min < 0 || data[i * CHUNK_CNT + pos[i]]
+                           < data[min * CHUNK_CNT + pos[min]]))
+          min = i;
+      merged[k] = data[min * CHUNK_CNT + pos[min]++];
+    }
+}
+
+void
+test_main (void)
+{
+  uint64_t start, seq_cycles, par_cycles, speedup;
+  uint32_t seed = 1;
+  int i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      data[i] = seed >> 1;
+    }
+  memcpy (sorted, data, sizeof data);
+
+  start = rdtsc ();
+  merge_sort (sorted, tmp, ELEM_CNT);
+  seq_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  parallel_sort ();
+  par_cycles = rdtsc () - start;
+
+  if (memcmp (sorted, merged, sizeof sorted))
+    fail ("parallel result differs from sequential result");
+  msg ("Parallel result matches sequential result.");
+
+  speedup = seq_cycles * 100 / (par_cycles ? par_cycles : 1);
+  msg ("Sorted %d elements: sequential %"PRIu64" cycles, "
+       "%d processes %"PRIu64" cycles, speedup %"PRIu64".%02"PRIu64".",
+       ELEM_CNT, seq_cycles, CHILD_CNT, par_cycles,
+       speedup / 100, speedup % 100);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "parallel sort result missing or wrong"
+  unless grep ($_ eq '(smp-merge) Parallel result matches sequential result.',
+	       @output);
+
+pass;
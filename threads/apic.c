@@ -0,0 +1,260 @@
+#include "threads/apic.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Local APIC and I/O APIC.  See [IA32-v3a] chapter 10 "Advanced
+   Programmable Interrupt Controller (APIC)" and the Intel 82093AA
+   I/O APIC datasheet for hardware details.
+
+   Compared to the 8259A PICs, the point is that acknowledging an
+   interrupt is a single memory-mapped write rather than port
+   I/O, which matters under virtualization, where every port
+   access is a VM exit. */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE (1 << 11)      /* Global enable. */
+
+/* Physical address of the I/O APIC.  This is where every PC
+   chipset puts the first one; we do not parse the ACPI tables
+   to look for others. */
+#define IOAPIC_PHYS 0xfec00000
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_ID 0x020                  /* Local APIC ID. */
+#define LAPIC_TPR 0x080                 /* Task priority. */
+#define LAPIC_EOI 0x0b0                 /* End of interrupt. */
+#define LAPIC_SVR 0x0f0                 /* Spurious interrupt vector. */
+#define LAPIC_IRR 0x200                 /* Interrupt request, 8 words. */
+#define LAPIC_ICR_LO 0x300              /* Interrupt command, low word. */
+#define LAPIC_ICR_HI 0x310              /* Interrupt command, high word. */
+#define LAPIC_LVT_TIMER 0x320           /* Local vector table: timer. */
+#define LAPIC_TIMER_INIT 0x380          /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390           /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0           /* Timer divide configuration. */
+
+#define SVR_ENABLE (1 << 8)             /* APIC software enable. */
+#define LVT_MASKED (1 << 16)            /* Interrupt masked. */
+#define LVT_PERIODIC (1 << 17)          /* Timer mode: periodic. */
+#define TIMER_DIV_16 0x3                /* Divide timer clock by 16. */
+
+#define ICR_FIXED 0x000                 /* Delivery mode: fixed vector. */
+#define ICR_INIT 0x500                  /* Delivery mode: INIT. */
+#define ICR_STARTUP 0x600               /* Delivery mode: startup. */
+#define ICR_PENDING (1 << 12)           /* Delivery status: send pending. */
+#define ICR_ASSERT (1 << 14)            /* Level: assert. */
+#define ICR_LEVEL (1 << 15)             /* Trigger mode: level. */
+
+/* I/O APIC registers, selected through IOREGSEL and accessed
+   through IOWIN. */
+#define IOAPIC_IOREGSEL 0x00
+#define IOAPIC_IOWIN 0x10
+#define IOAPIC_VER 0x01                 /* Version, max redirection entry. */
+#define IOAPIC_REDTBL(PIN) (0x10 + 2 * (PIN))
+
+#define REDTBL_MASKED (1 << 16)         /* Interrupt masked. */
+
+bool apic_enabled;
+
+/* Kernel virtual addresses of the register pages. */
+static volatile uint32_t *lapic;
+static volatile uint32_t *ioapic;
+
+static void *map_mmio (uint64_t pa);
+static uint32_t lapic_read (int reg);
+static void lapic_write (int reg, uint32_t value);
+static uint32_t ioapic_read (int reg);
+static void ioapic_write (int reg, uint32_t value);
+static void lapic_enable (void);
+static void lapic_send (unsigned apic_id, uint32_t command);
+
+/* Switches this CPU from the 8259A PICs to its local APIC and
+   masks every I/O APIC input, for apic_route_irq() to unmask.
+   Returns false, leaving everything alone, if the CPU has no
+   local APIC.  Must be called after paging_init() and before any
+   user process is created, since every page table shares the
+   kernel mappings made here. */
+bool
+apic_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t base;
+	int pins;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if ((edx & (1 << 9)) == 0)
+		return false;
+
+	base = read_msr (MSR_APIC_BASE);
+	write_msr (MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+	lapic = map_mmio (base & ~(uint64_t) PGMASK);
+	ioapic = map_mmio (IOAPIC_PHYS);
+
+	pins = ((ioapic_read (IOAPIC_VER) >> 16) & 0xff) + 1;
+	for (int pin = 0; pin < pins; pin++) {
+		ioapic_write (IOAPIC_REDTBL (pin), REDTBL_MASKED);
+		ioapic_write (IOAPIC_REDTBL (pin) + 1, 0);
+	}
+
+	lapic_enable ();
+	apic_enabled = true;
+	return true;
+}
+
+/* Switches an application processor to its local APIC.  The
+   registers are at the same address on every CPU, and were mapped
+   by apic_init(). */
+void
+apic_init_ap (void) {
+	uint64_t base = read_msr (MSR_APIC_BASE);
+
+	ASSERT (apic_enabled);
+	write_msr (MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+	lapic_enable ();
+}
+
+/* Returns the ID of this CPU's local APIC. */
+unsigned
+apic_id (void) {
+	return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Sends interrupt VEC_NO to the CPU whose local APIC has ID
+   APIC_ID. */
+void
+apic_send_ipi (unsigned apic_id, uint8_t vec_no) {
+	lapic_send (apic_id, ICR_FIXED | ICR_ASSERT | vec_no);
+}
+
+/* Sends an INIT IPI to the CPU whose local APIC has ID APIC_ID,
+   which resets it to wait for a startup IPI. */
+void
+apic_send_init (unsigned apic_id) {
+	lapic_send (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	lapic_send (apic_id, ICR_INIT | ICR_LEVEL);
+}
+
+/* Sends a startup IPI to the CPU whose local APIC has ID APIC_ID,
+   which starts it in real mode at physical address PA, which must
+   be page-aligned and below 1 MB. */
+void
+apic_send_startup (unsigned apic_id, uint64_t pa) {
+	ASSERT (pa % PGSIZE == 0 && pa < 0x100000);
+	lapic_send (apic_id, ICR_STARTUP | (pa >> PGBITS));
+}
+
+/* Signals the end of the interrupt being handled to the local
+   APIC. */
+void
+apic_eoi (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Routes ISA interrupt IRQ to interrupt vector VEC_NO on this
+   CPU, edge triggered and active high.  The ISA interrupts are
+   wired to the I/O APIC inputs of the same number, except for
+   IRQ 0, which must not be routed: the 8254 is wired to input 2
+   instead, in place of the PICs' cascade, and is reached by
+   routing IRQ 2. */
+void
+apic_route_irq (int irq, uint8_t vec_no) {
+	ASSERT (apic_enabled);
+	ASSERT (irq > 0 && irq < 16);
+
+	ioapic_write (IOAPIC_REDTBL (irq) + 1, lapic_read (LAPIC_ID) & 0xff000000);
+	ioapic_write (IOAPIC_REDTBL (irq), vec_no);
+}
+
+/* Returns true if interrupt VEC_NO has been accepted by the local
+   APIC but not yet delivered to the CPU, e.g. because interrupts
+   are off. */
+bool
+apic_pending (uint8_t vec_no) {
+	return (lapic_read (LAPIC_IRR + vec_no / 32 * 0x10) >> (vec_no % 32)) & 1;
+}
+
+/* Starts the local APIC timer interrupting at VEC_NO every COUNT
+   timer clocks. */
+void
+lapic_timer_periodic (uint8_t vec_no, uint32_t count) {
+	ASSERT (count > 0);
+
+	lapic_write (LAPIC_LVT_TIMER, LVT_PERIODIC | vec_no);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Starts the local APIC timer counting down from COUNT timer
+   clocks, interrupting at VEC_NO once it reaches 0. */
+void
+lapic_timer_oneshot (uint8_t vec_no, uint32_t count) {
+	ASSERT (count > 0);
+
+	lapic_write (LAPIC_LVT_TIMER, vec_no);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Returns the local APIC timer's current count.  In one-shot
+   mode, 0 means that the count has expired. */
+uint32_t
+lapic_timer_current (void) {
+	return lapic_read (LAPIC_TIMER_CUR);
+}
+
+/* Maps the page of memory-mapped registers at physical address PA
+   into the kernel's address space, uncached, and returns its
+   kernel virtual address. */
+static void *
+map_mmio (uint64_t pa) {
+	void *va = ptov (pa);
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) va, 1);
+
+	if (pte == NULL)
+		PANIC ("couldn't map APIC registers");
+	*pte = pa | PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+	invlpg ((uint64_t) va);
+	return va;
+}
+
+/* Enables this CPU's local APIC, with its timer masked. */
+static void
+lapic_enable (void) {
+	lapic_write (LAPIC_TPR, 0);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED);
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_SVR, SVR_ENABLE | APIC_SPURIOUS_VEC);
+}
+
+/* Sends COMMAND to the local APIC with ID APIC_ID and waits for
+   the local APIC to send it. */
+static void
+lapic_send (unsigned apic_id, uint32_t command) {
+	lapic_write (LAPIC_ICR_HI, apic_id << 24);
+	lapic_write (LAPIC_ICR_LO, command);
+	while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+		asm volatile ("pause");
+}
+
+static uint32_t
+lapic_read (int reg) {
+	return lapic[reg / 4];
+}
+
+static void
+lapic_write (int reg, uint32_t value) {
+	lapic[reg / 4] = value;
+}
+
+static uint32_t
+ioapic_read (int reg) {
+	ioapic[IOAPIC_IOREGSEL / 4] = reg;
+	return ioapic[IOAPIC_IOWIN / 4];
+}
+
+static void
+ioapic_write (int reg, uint32_t value) {
+	ioapic[IOAPIC_IOREGSEL / 4] = reg;
+	ioapic[IOAPIC_IOWIN / 4] = value;
+}
@@ -0,0 +1,398 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/apic.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/tss.h"
+#endif
+
+/* Per-CPU data, indexed by CPU number.  The bootstrap processor
+   is CPU 0. */
+struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs in use. */
+unsigned cpu_cnt;
+
+/* Model-specific registers holding the GS base in the kernel and,
+   swapped in by `swapgs', in user mode. */
+#define MSR_GS_BASE 0xc0000101
+#define MSR_KERNEL_GS_BASE 0xc0000102
+
+/* The big kernel lock.
+
+   Most of the kernel protects its data by turning interrupts off,
+   which only keeps out the CPU's own interrupt handlers.  So a
+   CPU holds this lock whenever it runs kernel code, and releases
+   it only to run user code or to halt in its idle thread: user
+   programs run in parallel, the kernel does not.  The lock belongs
+   to the CPU rather than to a thread, and the CPU keeps it across
+   thread switches. */
+static struct cpu *volatile kernel_lock_owner;
+
+/* Stack for the application processor being started, read by
+   threads/trampoline.S. */
+void *ap_boot_stack;
+
+/* MP floating pointer structure and configuration table.  See
+   the Intel MultiProcessor Specification, version 1.4, chapter
+   4.  The BIOS lists the CPUs there; unlike the ACPI tables, it
+   is always in low memory. */
+struct mp_float {
+	char signature[4];                  /* "_MP_". */
+	uint32_t config;                    /* Physical address of table. */
+	uint8_t length;                     /* In 16-byte units. */
+	uint8_t version;
+	uint8_t checksum;
+	uint8_t features[5];
+} __attribute__ ((packed));
+
+struct mp_config {
+	char signature[4];                  /* "PCMP". */
+	uint16_t length;                    /* Base table length. */
+	uint8_t version;
+	uint8_t checksum;
+	char oem[8];
+	char product[12];
+	uint32_t oem_table;
+	uint16_t oem_length;
+	uint16_t entry_cnt;                 /* # of entries after header. */
+	uint32_t lapic;
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__ ((packed));
+
+/* Processor entry, the only kind we look at.  Every other kind
+   is 8 bytes long. */
+#define MP_PROC 0
+struct mp_proc {
+	uint8_t type;                       /* MP_PROC. */
+	uint8_t apic_id;                    /* Local APIC ID. */
+	uint8_t apic_version;
+	uint8_t flags;                      /* MP_PROC_* below. */
+	uint32_t signature;
+	uint32_t features;
+	uint8_t reserved[8];
+} __attribute__ ((packed));
+#define MP_PROC_ENABLED 0x01            /* Usable. */
+#define MP_PROC_BSP 0x02                /* Bootstrap processor. */
+
+static void cpu_set_gs (struct cpu *);
+static bool cpu_start (struct cpu *, unsigned apic_id);
+static void cpu_tlb_flush (void);
+static intr_handler_func tlb_interrupt;
+static struct mp_config *mp_find_config (void);
+static struct mp_float *mp_search (uint64_t pa, size_t size);
+static bool mp_checksum_ok (const void *, size_t);
+
+/* Sets up the per-CPU data of the bootstrap processor, which is
+   CPU 0 and starts out holding the big kernel lock.  Must be
+   called before anything that calls cpu_current() or
+   intr_context(), such as printf(). */
+void
+cpu_init (void) {
+	/* The entry code reaches these members through %gs. */
+	ASSERT (offsetof (struct cpu, self) == 0);
+	ASSERT (offsetof (struct cpu, scratch) == 8);
+	ASSERT (offsetof (struct cpu, tss) == 16);
+
+	memset (cpus, 0, sizeof cpus);
+	for (unsigned i = 0; i < CPU_MAX; i++) {
+		cpus[i].self = &cpus[i];
+		cpus[i].id = i;
+	}
+	cpus[0].online = true;
+	cpu_cnt = 1;
+	cpu_set_gs (&cpus[0]);
+	kernel_lock_owner = &cpus[0];
+}
+
+/* Sets up the per-CPU data of an application processor, which is
+   running on the stack of the idle thread that cpu_start() made
+   for it, and takes the big kernel lock.  Interrupts must be
+   off. */
+void
+cpu_init_ap (void) {
+	struct cpu *c = thread_current ()->cpu;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	cpu_set_gs (c);
+	pml4_activate (NULL);
+	apic_init_ap ();
+	kernel_lock ();
+}
+
+/* Starts the application processors that the MP configuration
+   table lists, one at a time, and returns once each is online or
+   has failed to start.  Does nothing without a local APIC or an
+   MP table.  Must be called by the bootstrap processor with
+   interrupts on, since it sleeps while the others start. */
+void
+cpu_start_aps (void) {
+	extern char ap_trampoline[], ap_trampoline_end[];
+	struct mp_config *config;
+	uint8_t *entry;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	if (!apic_enabled)
+		return;
+	config = mp_find_config ();
+	if (config == NULL)
+		return;
+
+	cpus[0].apic_id = apic_id ();
+	intr_register_ipi (CPU_TLB_VEC, tlb_interrupt, "TLB shootdown");
+	memcpy (ptov (AP_TRAMPOLINE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+
+	entry = (uint8_t *) (config + 1);
+	for (unsigned i = 0; i < config->entry_cnt; i++) {
+		struct mp_proc *proc = (struct mp_proc *) entry;
+
+		if (proc->type != MP_PROC) {
+			entry += 8;
+			continue;
+		}
+		entry += sizeof *proc;
+		if (!(proc->flags & MP_PROC_ENABLED) || (proc->flags & MP_PROC_BSP)
+				|| proc->apic_id == cpus[0].apic_id)
+			continue;
+		if (cpu_cnt == CPU_MAX) {
+			printf ("cpu: only %d CPUs are supported\n", CPU_MAX);
+			break;
+		}
+		if (!cpu_start (&cpus[cpu_cnt], proc->apic_id)) {
+			printf ("cpu: CPU with APIC ID %u did not start\n", proc->apic_id);
+			break;
+		}
+		cpu_cnt++;
+	}
+}
+
+/* Returns the CPU we are running on, from its GS base.  The
+   caller must not be moved to another CPU while it uses the
+   result: it should run with interrupts off or be the CPU's idle
+   thread.
+
+   Unlike thread_current(), this works in the middle of a
+   context switch, while the running thread's status is no
+   longer THREAD_RUNNING. */
+struct cpu *
+cpu_current (void) {
+	struct cpu *c;
+
+	asm volatile ("movq %%gs:0, %0" : "=r" (c));
+	return c;
+}
+
+/* Interrupts C, if it is another CPU, to have it check whether a
+   thread just made ready on it should preempt the thread it is
+   running. */
+void
+cpu_kick (struct cpu *c) {
+	enum intr_level old_level = intr_disable ();
+
+	if (c != cpu_current () && c->online)
+		apic_send_ipi (c->apic_id, CPU_RESCHEDULE_VEC);
+	intr_set_level (old_level);
+}
+
+/* Has every other CPU that is using PML4 flush its TLB, and waits
+   until they all have, after a change to PML4 that this CPU
+   already flushed from its own TLB.  Since the caller holds the
+   big kernel lock, no other CPU can switch to PML4 meanwhile. */
+void
+cpu_tlb_shootdown (uint64_t *pml4) {
+	enum intr_level old_level;
+	struct cpu *self;
+	unsigned i;
+
+	if (cpu_cnt == 1)
+		return;
+
+	old_level = intr_disable ();
+	self = cpu_current ();
+	ASSERT (kernel_lock_held ());
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+		if (c != self && c->pml4 == pml4) {
+			c->tlb_flush = true;
+			apic_send_ipi (c->apic_id, CPU_TLB_VEC);
+		}
+	}
+	for (i = 0; i < cpu_cnt; i++)
+		while (cpus[i].tlb_flush)
+			asm volatile ("pause");
+	intr_set_level (old_level);
+}
+
+/* Acquires the big kernel lock for this CPU, which must not hold
+   it already, spinning until it is free.  Meanwhile, answers TLB
+   shootdowns from the CPU that holds it, which waits for them
+   with interrupts off. */
+void
+kernel_lock (void) {
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = cpu_current ();
+
+	ASSERT (kernel_lock_owner != c);
+	while (!__sync_bool_compare_and_swap (&kernel_lock_owner, NULL, c)) {
+		if (c->tlb_flush)
+			cpu_tlb_flush ();
+		asm volatile ("pause");
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases the big kernel lock, which this CPU must hold.
+   Interrupts must be off, so that nothing runs in the kernel on
+   this CPU without the lock until it leaves the kernel. */
+void
+kernel_unlock (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (kernel_lock_held ());
+
+	__atomic_store_n (&kernel_lock_owner, NULL, __ATOMIC_RELEASE);
+}
+
+/* Returns true if this CPU holds the big kernel lock. */
+bool
+kernel_lock_held (void) {
+	enum intr_level old_level = intr_disable ();
+	bool held = kernel_lock_owner == cpu_current ();
+
+	intr_set_level (old_level);
+	return held;
+}
+
+/* Points the running CPU's GS base to C, and its user GS base,
+   which `swapgs' exchanges with it on every entry to and exit
+   from the kernel, to 0.  The GS selector is never loaded again
+   afterward, since in 64-bit mode that also reloads the base. */
+static void
+cpu_set_gs (struct cpu *c) {
+	asm volatile ("movw %w0, %%gs" : : "r" (0));
+	write_msr (MSR_GS_BASE, (uint64_t) c);
+	write_msr (MSR_KERNEL_GS_BASE, 0);
+}
+
+/* Starts the application processor whose local APIC has ID
+   APIC_ID as C, following the INIT-SIPI-SIPI sequence of the
+   MultiProcessor Specification, appendix B.4, and waits up to
+   100 ms for it to come online.  Returns true if it did. */
+static bool
+cpu_start (struct cpu *c, unsigned apic_id) {
+	struct thread *idle;
+
+	/* Everything the processor needs that could sleep to allocate
+	   is allocated here, since it has no thread to sleep in
+	   before its idle thread starts running. */
+	c->apic_id = apic_id;
+	idle = thread_create_idle (c);
+	if (idle == NULL)
+		return false;
+#ifdef USERPROG
+	tss_init (c);
+#endif
+	ap_boot_stack = (uint8_t *) idle + PGSIZE;
+
+	apic_send_init (apic_id);
+	timer_msleep (10);
+	for (int i = 0; i < 2 && !c->online; i++) {
+		apic_send_startup (apic_id, AP_TRAMPOLINE);
+		timer_usleep (200);
+	}
+	for (int i = 0; i < 100 && !c->online; i++)
+		timer_msleep (1);
+
+	if (!c->online) {
+		/* Stop it, in case it is just slow, before giving up. */
+		apic_send_init (apic_id);
+		return false;
+	}
+	return true;
+}
+
+/* Flushes this CPU's TLB, as another CPU asked. */
+static void
+cpu_tlb_flush (void) {
+	struct cpu *c = cpu_current ();
+
+	lcr3 (rcr3 ());
+	__atomic_store_n (&c->tlb_flush, false, __ATOMIC_RELEASE);
+}
+
+/* TLB shootdown interrupt handler.  Runs without the big kernel
+   lock; see intr_handler(). */
+static void
+tlb_interrupt (struct intr_frame *f UNUSED) {
+	cpu_tlb_flush ();
+}
+
+/* Returns the MP configuration table, or a null pointer if the
+   BIOS did not provide one.  The floating pointer to it is in the
+   first kB of the extended BIOS data area, in the last kB of base
+   memory, or in the BIOS ROM. */
+static struct mp_config *
+mp_find_config (void) {
+	uint8_t *bda = ptov (0x400);
+	uint64_t ebda = *(uint16_t *) (bda + 0x0e) << 4;
+	uint64_t base_kb = *(uint16_t *) (bda + 0x13);
+	struct mp_float *mp = NULL;
+	struct mp_config *config;
+
+	if (ebda != 0)
+		mp = mp_search (ebda, 1024);
+	if (mp == NULL)
+		mp = mp_search (base_kb * 1024 - 1024, 1024);
+	if (mp == NULL)
+		mp = mp_search (0xf0000, 0x10000);
+	/* The table could be anywhere, but BIOSes put it in low
+	   memory, which is all we know to be mapped. */
+	if (mp == NULL || mp->config == 0 || mp->config >= 0x100000)
+		return NULL;
+
+	config = ptov (mp->config);
+	if (memcmp (config->signature, "PCMP", 4)
+			|| !mp_checksum_ok (config, config->length))
+		return NULL;
+	return config;
+}
+
+/* Looks for the MP floating pointer structure in the SIZE bytes
+   of physical memory at PA. */
+static struct mp_float *
+mp_search (uint64_t pa, size_t size) {
+	uint8_t *p = ptov (pa);
+
+	for (size_t ofs = 0; ofs + sizeof (struct mp_float) <= size; ofs += 16) {
+		struct mp_float *mp = (struct mp_float *) (p + ofs);
+		if (!memcmp (mp->signature, "_MP_", 4)
+				&& mp_checksum_ok (mp, sizeof *mp))
+			return mp;
+	}
+	return NULL;
+}
+
+/* Returns true if the SIZE bytes at P sum to 0 mod 256, as every
+   MP structure must. */
+static bool
+mp_checksum_ok (const void *p_, size_t size) {
+	const uint8_t *p = p_;
+	uint8_t sum = 0;
+
+	while (size-- > 0)
+		sum += *p++;
+	return sum == 0;
+}
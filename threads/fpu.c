@@ -0,0 +1,309 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* FPU, SSE and AVX state.
+
+   The kernel does not use the FPU (it is built with -mno-sse
+   -msoft-float), so only threads that execute FPU or vector
+   instructions have FPU state, and the registers are switched
+   lazily.  Each CPU remembers the thread whose state is in its
+   registers, its `fpu_owner'.  Switching to any other thread sets
+   CR0.TS, so that the thread's first FPU instruction raises #NM;
+   fpu_trap() then saves the owner's registers into its save area,
+   loads the thread's and makes it the owner.  A thread that is
+   switched away from and back to without another thread using the
+   FPU in between does not have its registers saved at all.
+
+   A thread's save area is allocated at its first FPU instruction,
+   starting from the state the FPU is in after FNINIT.  It is
+   saved with XSAVE, covering x87, SSE and, if the CPU has it,
+   AVX, or with FXSAVE on CPUs without XSAVE. */
+
+/* CR0 bits. */
+#define CR0_MP (1 << 1)         /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)         /* Emulate FPU. */
+#define CR0_TS (1 << 3)         /* Task switched. */
+#define CR0_NE (1 << 5)         /* Native FPU error reporting. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR (1 << 9)     /* FXSAVE and SSE enabled. */
+#define CR4_OSXMMEXCPT (1 << 10) /* #XF enabled. */
+#define CR4_OSXSAVE (1 << 18)   /* XSAVE and XCR0 enabled. */
+
+/* CPUID leaf 1 ECX bits. */
+#define CPUID_XSAVE (1 << 26)
+#define CPUID_AVX (1 << 28)
+
+/* XCR0 state components. */
+#define XSTATE_X87 (1 << 0)
+#define XSTATE_SSE (1 << 1)
+#define XSTATE_AVX (1 << 2)
+
+#define FPU_ALIGN 64            /* XSAVE needs 64, FXSAVE 16. */
+#define FXSAVE_SIZE 512
+
+static bool use_xsave;          /* XSAVE, or FXSAVE? */
+static uint64_t fpu_xcr0;       /* State components XSAVE covers. */
+static size_t fpu_size;         /* Size of a save area. */
+static uint8_t fpu_init_state[1024] __attribute__ ((aligned (FPU_ALIGN)));
+
+static intr_handler_func fpu_trap;
+static void fpu_enable (void);
+
+/* Returns the save area of T, which must have one. */
+static void *
+fpu_area (struct thread *t) {
+	return (void *) ROUND_UP ((uintptr_t) t->fpu, FPU_ALIGN);
+}
+
+/* Saves the FPU registers into AREA. */
+static void
+fpu_save (void *area) {
+	if (use_xsave)
+		__asm __volatile ("xsave64 (%0)"
+				:: "r" (area), "a" (-1), "d" (-1) : "memory");
+	else
+		__asm __volatile ("fxsave64 (%0)" :: "r" (area) : "memory");
+}
+
+/* Loads the FPU registers from AREA. */
+static void
+fpu_load (const void *area) {
+	if (use_xsave)
+		__asm __volatile ("xrstor64 (%0)"
+				:: "r" (area), "a" (-1), "d" (-1) : "memory");
+	else
+		__asm __volatile ("fxrstor64 (%0)" :: "r" (area) : "memory");
+}
+
+/* Sets CR0.TS, so that the next FPU instruction traps. */
+static void
+stts (void) {
+	uint64_t cr0 = rcr0 ();
+
+	if (!(cr0 & CR0_TS))
+		lcr0 (cr0 | CR0_TS);
+}
+
+/* Enables the FPU, SSE and, where the CPU has them, XSAVE and
+   AVX, records the initial FPU state, and installs the #NM
+   handler. */
+void
+fpu_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	use_xsave = (ecx & CPUID_XSAVE) != 0;
+
+	fpu_size = FXSAVE_SIZE;
+	if (use_xsave) {
+		fpu_xcr0 = XSTATE_X87 | XSTATE_SSE | (ecx & CPUID_AVX ? XSTATE_AVX : 0);
+		cpuid (0xd, 0, &eax, &ebx, &ecx, &edx);
+		fpu_xcr0 &= eax;
+	}
+	fpu_enable ();
+	if (use_xsave) {
+		cpuid (0xd, 0, &eax, &ebx, &ecx, &edx);
+		fpu_size = ebx;
+	}
+	ASSERT (fpu_size <= sizeof fpu_init_state);
+
+	__asm __volatile ("fninit");
+	fpu_save (fpu_init_state);
+	stts ();
+
+	intr_register_int (7, 0, INTR_ON, fpu_trap,
+			"#NM Device Not Available Exception");
+}
+
+/* Enables the FPU on an application processor, the same way
+   fpu_init() did on the bootstrap processor. */
+void
+fpu_init_ap (void) {
+	fpu_enable ();
+	stts ();
+}
+
+/* Turns on the FPU, SSE and, if USE_XSAVE, XSAVE with the state
+   components in FPU_XCR0, on this CPU. */
+static void
+fpu_enable (void) {
+	lcr0 ((rcr0 () | CR0_MP | CR0_NE) & ~(CR0_EM | CR0_TS));
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT
+			| (use_xsave ? CR4_OSXSAVE : 0));
+	if (use_xsave)
+		xsetbv (0, fpu_xcr0);
+}
+
+/* Prepares the FPU for switching to NEXT: unless NEXT's state is
+   already in the registers, its first FPU instruction must trap.
+   Interrupts must be off. */
+void
+fpu_switch (struct thread *next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (cpu_current ()->fpu_owner == next)
+		clts ();
+	else
+		stts ();
+}
+
+/* Gives the running thread, which executed an FPU instruction
+   with CR0.TS set, the FPU. */
+static void
+fpu_trap (struct intr_frame *f) {
+	struct thread *t = thread_current ();
+	struct cpu *c;
+	enum intr_level old_level;
+
+	if (t->fpu == NULL) {
+		t->fpu = malloc (fpu_size + FPU_ALIGN - 1);
+		if (t->fpu == NULL) {
+			if (f->cs != SEL_UCSEG)
+				PANIC ("out of memory for FPU state");
+			printf ("%s: dying due to interrupt %#04llx (%s).\n",
+					thread_name (), f->vec_no, intr_name (f->vec_no));
+			thread_exit ();
+		}
+		memcpy (fpu_area (t), fpu_init_state, fpu_size);
+	}
+
+	old_level = intr_disable ();
+	c = cpu_current ();
+	clts ();
+	if (c->fpu_owner != t) {
+		if (c->fpu_owner != NULL)
+			fpu_save (fpu_area (c->fpu_owner));
+		fpu_load (fpu_area (t));
+		c->fpu_owner = t;
+	}
+	intr_set_level (old_level);
+}
+
+/* Saves the running thread's FPU registers, if they are loaded,
+   into its save area, for fpu_copy() to read, possibly on
+   another CPU.  The thread stays the owner of the registers. */
+void
+fpu_sync (void) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+	struct cpu *c;
+
+	old_level = intr_disable ();
+	c = cpu_current ();
+	if (c->fpu_owner == t) {
+		/* It stays the owner, so it must trap again afterward,
+		   unless it was running with CR0.TS clear. */
+		uint64_t cr0 = rcr0 ();
+		clts ();
+		fpu_save (fpu_area (t));
+		lcr0 (cr0);
+	}
+	intr_set_level (old_level);
+}
+
+/* Saves the FPU registers of T, which is about to block, if they
+   are loaded on this CPU, and takes them away from it, so that T
+   can be woken up on any CPU.  Interrupts must be off. */
+void
+fpu_unload (struct thread *t) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (c->fpu_owner == t) {
+		clts ();
+		fpu_save (fpu_area (t));
+		c->fpu_owner = NULL;
+		stts ();
+	}
+}
+
+/* Gives the running thread a copy of the FPU state of PARENT,
+   which is not running and called fpu_sync() before it stopped,
+   for fork().  Returns false if memory is exhausted. */
+bool
+fpu_copy (struct thread *parent) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t->fpu == NULL);
+
+	if (parent->fpu == NULL)
+		return true;
+	t->fpu = malloc (fpu_size + FPU_ALIGN - 1);
+	if (t->fpu == NULL)
+		return false;
+	memcpy (fpu_area (t), fpu_area (parent), fpu_size);
+	return true;
+}
+
+/* Discards the FPU state of T, which must be the running thread,
+   as when it exits or executes a new program. */
+void
+fpu_release (struct thread *t) {
+	enum intr_level old_level;
+	void *area;
+
+	ASSERT (t == thread_current ());
+
+	old_level = intr_disable ();
+	if (cpu_current ()->fpu_owner == t) {
+		cpu_current ()->fpu_owner = NULL;
+		stts ();
+	}
+	area = t->fpu;
+	t->fpu = NULL;
+	intr_set_level (old_level);
+	free (area);
+}
+
+/* Lets kernel code use the FPU and vector registers until
+   kernel_fpu_end().  Saves the registers of the thread that owns
+   them, loads the initial state, and turns off interrupts, so the
+   code in between must not sleep.  May not be nested or used in
+   an interrupt handler. */
+void
+kernel_fpu_begin (void) {
+	enum intr_level old_level;
+	struct cpu *c;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	c = cpu_current ();
+	ASSERT (!c->in_kernel_fpu);
+	c->in_kernel_fpu = true;
+	c->kernel_fpu_intr_on = old_level == INTR_ON;
+
+	clts ();
+	if (c->fpu_owner != NULL) {
+		fpu_save (fpu_area (c->fpu_owner));
+		c->fpu_owner = NULL;
+	}
+	fpu_load (fpu_init_state);
+}
+
+/* Ends a kernel_fpu_begin() section.  The next thread to use the
+   FPU reloads its state. */
+void
+kernel_fpu_end (void) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (c->in_kernel_fpu);
+
+	stts ();
+	c->in_kernel_fpu = false;
+	if (c->kernel_fpu_intr_on)
+		intr_enable ();
+}
@@ -3,6 +3,8 @@
 #include <debug.h>
 #include <limits.h>
 #include <random.h>
+#include <round.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -13,6 +15,8 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -20,7 +24,11 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -46,6 +54,9 @@ uint64_t *base_pml4;
 static bool format_filesys;
 #endif
 
+/* -smp: Start the application processors? */
+static bool start_aps;
+
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
@@ -56,6 +67,7 @@ static void paging_init (uint64_t mem_end);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
+static size_t parse_count (const char *value);
 static void run_actions (char **argv);
 static void usage (void);
 
@@ -63,6 +75,7 @@ static void print_stats (void);
 
 
 int main (void) NO_RETURN;
+void ap_main (void) NO_RETURN;
 
 /* Pintos main program. */
 int
@@ -72,6 +85,7 @@ main (void) {
 
 	/* Clear BSS and get machine's RAM size. */
 	bss_init ();
+	cpu_init ();
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line ();
@@ -85,26 +99,34 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_cache_init ();
 	paging_init (mem_end);
+	palloc_init_high ();
 
 #ifdef USERPROG
-	tss_init ();
+	tss_init (cpu_current ());
 	gdt_init ();
 #endif
 
 	/* Initialize interrupt handlers. */
 	intr_init ();
+	fpu_init ();
 	timer_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	process_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_init ();
+	rcu_init ();
 	serial_init_queue ();
 	timer_calibrate ();
+	if (start_aps)
+		cpu_start_aps ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -127,6 +149,26 @@ main (void) {
 	thread_exit ();
 }
 
+/* Application processor main program, called by ap_high in
+   threads/trampoline.S on the stack of the processor's idle
+   thread, with interrupts off.  Sets up the per-CPU state that
+   main() set up for the bootstrap processor, then goes idle until
+   the scheduler gives this processor work. */
+void
+ap_main (void) {
+	cpu_init_ap ();
+#ifdef USERPROG
+	gdt_init ();
+#endif
+	intr_init_ap ();
+	fpu_init_ap ();
+	timer_init_ap ();
+#ifdef USERPROG
+	syscall_init_ap ();
+#endif
+	thread_start_ap ();
+}
+
 /* Clear BSS */
 static void
 bss_init (void) {
@@ -140,26 +182,56 @@ bss_init (void) {
 	memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Returns true if the CPU can map 1 GB pages with a PDPE. */
+static bool
+huge_pages_supported (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (0x80000000, 0, &eax, &ebx, &ecx, &edx);
+	if (eax < 0x80000001)
+		return false;
+	cpuid (0x80000001, 0, &eax, &ebx, &ecx, &edx);
+	return (edx & (1 << 26)) != 0;
+}
+
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * Memory is mapped with the largest pages that fit: 1 GB pages
+ * where the CPU has them and both addresses are aligned, 2 MB
+ * pages otherwise, and 4 kB pages only for the 2 MB around the
+ * kernel text, which is mapped read-only, and for the tail of
+ * memory that does not fill a 2 MB page. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
+	uint64_t text_lo, text_hi;
+	size_t max_size, size;
 	int perm;
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	text_lo = vtop (&start) & ~(LARGE_PGSIZE - 1);
+	text_hi = ROUND_UP (vtop (&_end_kernel_text), LARGE_PGSIZE);
+	max_size = huge_pages_supported () ? HUGE_PGSIZE : LARGE_PGSIZE;
+
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	for (uint64_t pa = 0; pa < mem_end; pa += size) {
 		uint64_t va = (uint64_t) ptov(pa);
 
 		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
+		for (size = max_size; size > PGSIZE; size >>= 9)
+			if (pa % size == 0 && va % size == 0 && pa + size <= mem_end
+					&& (pa + size <= text_lo || pa >= text_hi))
+				break;
+		if (size > PGSIZE)
+			perm |= PTE_PS;
+		else if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
-		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
+		if ((pte = pml4e_walk_size (pml4, va, size)) != NULL)
 			*pte = pa | perm;
 	}
 
@@ -221,9 +293,28 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-smp"))
+			start_aps = true;
+		else if (!strcmp (name, "-tcache"))
+			thread_cache_max = parse_count (value);
+		else if (!strcmp (name, "-zero")) {
+			char *high = value != NULL ? strchr (value, ',') : NULL;
+			if (high == NULL)
+				PANIC ("-zero requires LOW,HIGH");
+			palloc_zero_low = atoi (value);
+			palloc_zero_high = atoi (high + 1);
+			if (palloc_zero_low > palloc_zero_high)
+				PANIC ("-zero: LOW exceeds HIGH");
+		}
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+		else if (!strcmp (name, "-nothp"))
+			thp_enabled = false;
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
 #endif
@@ -231,9 +322,30 @@ parse_options (char **argv) {
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs are mutually exclusive");
+
 	return argv;
 }
 
+/* Returns VALUE, the argument of an option that takes a count,
+   as a number.  Prints usage and powers off if VALUE is missing,
+   negative, not a number or too large. */
+static size_t
+parse_count (const char *value) {
+	size_t count = 0;
+
+	if (value == NULL || *value == '\0')
+		usage ();
+	for (; *value != '\0'; value++) {
+		if (*value < '0' || *value > '9'
+				|| count > (SIZE_MAX - (*value - '0')) / 10)
+			usage ();
+		count = count * 10 + (*value - '0');
+	}
+	return count;
+}
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv) {
@@ -326,8 +438,14 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -smp               Start the other CPUs, if there are any.\n"
+			"  -tcache=COUNT      Keep up to COUNT exited threads' pages.\n"
+			"  -zero=LOW,HIGH     Watermarks of pages zeroed while idle.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -nothp             Map user memory with 4 kB pages only.\n"
 #endif
 			);
 	power_off ();
@@ -354,6 +472,9 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	kmem_cache_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -3,6 +3,8 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
@@ -82,14 +84,18 @@ static struct desc_ptr idt_desc = {
 /* Creates an interrupt gate that invokes FUNCTION with the given DPL. */
 #define make_intr_gate(g, function, dpl) make_gate((g), (function), (dpl), 14)
 
-/* Creates a trap gate that invokes FUNCTION with the given DPL. */
-#define make_trap_gate(g, function, dpl) make_gate((g), (function), (dpl), 15)
-
 
 
 /* Interrupt handler functions for each interrupt. */
 static intr_handler_func *intr_handlers[INTR_CNT];
 
+/* Interrupt level each handler runs with.  Every gate is an
+   interrupt gate, so that no interrupt can arrive before the
+   entry code has switched to the kernel GS base, and
+   intr_handler() turns interrupts back on for handlers that run
+   with INTR_ON, as a trap gate would. */
+static enum intr_level intr_levels[INTR_CNT];
+
 /* Names for each interrupt, for debugging purposes. */
 static const char *intr_names[INTR_CNT];
 
@@ -99,13 +105,18 @@ static const char *intr_names[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU handles its own external
+   interrupts, so the flags for this are in struct cpu. */
+
+/* Interprocessor interrupts are the vectors from 0xf0 up to the
+   APIC spurious vector.  They are acknowledged on the local APIC
+   and otherwise handled like external interrupts. */
+#define is_ipi(VEC) ((VEC) >= 0xf0 && (VEC) < APIC_SPURIOUS_VEC)
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static intr_handler_func spurious_interrupt;
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
@@ -164,8 +175,13 @@ void
 intr_init (void) {
 	int i;
 
-	/* Initialize interrupt controller. */
+	/* Initialize interrupt controller.  If there is a local APIC,
+	   use it and keep the PICs quiet. */
 	pic_init ();
+	if (apic_init ()) {
+		outb (0x21, 0xff);
+		outb (0xa1, 0xff);
+	}
 
 	/* Initialize IDT. */
 	for (i = 0; i < INTR_CNT; i++) {
@@ -201,6 +217,23 @@ intr_init (void) {
 	intr_names[17] = "#AC Alignment Check Exception";
 	intr_names[18] = "#MC Machine-Check Exception";
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
+
+	if (apic_enabled)
+		intr_register_int (APIC_SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+				"APIC spurious");
+}
+
+/* Initializes the interrupt system of an application processor,
+   which shares the IDT set up by intr_init(). */
+void
+intr_init_ap (void) {
+#ifdef USERPROG
+	/* Load TSS. */
+	ltr (SEL_TSS);
+#endif
+
+	/* Load IDT register. */
+	lidt(&idt_desc);
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -211,24 +244,27 @@ static void
 register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name) {
 	ASSERT (intr_handlers[vec_no] == NULL);
-	if (level == INTR_ON) {
-		make_trap_gate(&idt[vec_no], intr_stubs[vec_no], dpl);
-	}
-	else {
-		make_intr_gate(&idt[vec_no], intr_stubs[vec_no], dpl);
-	}
+	make_intr_gate(&idt[vec_no], intr_stubs[vec_no], dpl);
 	intr_handlers[vec_no] = handler;
+	intr_levels[vec_no] = level;
 	intr_names[vec_no] = name;
 }
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.
+
+   With the APIC, the ISA interrupt for VEC_NO is routed to it
+   now.  Vector 0x20 is the exception: the 8254 behind IRQ 0 is
+   replaced by the local APIC timer, which delivers to 0x20
+   itself (see devices/timer.c). */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
 	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
+	if (apic_enabled && vec_no != 0x20)
+		apic_route_irq (vec_no - 0x20, vec_no);
 }
 
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
@@ -249,14 +285,27 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
 	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (!is_ipi (vec_no));
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
+/* Registers interprocessor interrupt VEC_NO, sent by another CPU
+   through the local APICs, to invoke HANDLER, which is named NAME
+   for debugging purposes.  The handler runs as an external
+   interrupt handler does. */
+void
+intr_register_ipi (uint8_t vec_no, intr_handler_func *handler,
+		const char *name) {
+	ASSERT (apic_enabled);
+	ASSERT (is_ipi (vec_no));
+	register_handler (vec_no, 0, INTR_OFF, handler, name);
+}
+
 /* Returns true during processing of an external interrupt
    and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -266,7 +315,7 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -330,20 +379,50 @@ pic_end_of_interrupt (int irq) {
    interrupted thread's registers. */
 void
 intr_handler (struct intr_frame *frame) {
-	bool external;
+	struct cpu *c = cpu_current ();
+	bool external, locked;
 	intr_handler_func *handler;
+#ifdef USERPROG
+	bool from_user;
+#endif
+
+	/* A TLB shootdown is answered without the big kernel lock,
+	   since the CPU that holds it waits for the answer. */
+	if (frame->vec_no == CPU_TLB_VEC) {
+		intr_handlers[CPU_TLB_VEC] (frame);
+		apic_eoi ();
+		return;
+	}
+
+	/* Take the big kernel lock, unless we interrupted kernel code,
+	   which holds it already.  Without it, this CPU was running
+	   user code or halted in its idle thread. */
+	locked = kernel_lock_held ();
+	if (!locked)
+		kernel_lock ();
+
+#ifdef USERPROG
+	from_user = frame->cs == SEL_UCSEG;
+	if (from_user)
+		thread_enter_kernel ();
+#endif
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = (frame->vec_no >= 0x20 && frame->vec_no < 0x30)
+		|| is_ipi (frame->vec_no);
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c->in_external_intr = true;
+		c->yield_on_return = false;
+	} else if (intr_levels[frame->vec_no] == INTR_ON
+			&& (frame->eflags & FLAG_IF)) {
+		/* As if entered through a trap gate. */
+		intr_enable ();
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -366,12 +445,32 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		c->in_external_intr = false;
+		if (apic_enabled)
+			apic_eoi ();
+		else
+			pic_end_of_interrupt (frame->vec_no);
 
-		if (yield_on_return)
+		if (c->yield_on_return)
 			thread_yield ();
 	}
+#ifdef USERPROG
+	if (from_user)
+		thread_leave_kernel ();
+#endif
+
+	/* We may have moved to another CPU in thread_yield(), but
+	   then that CPU took over the lock along with us. */
+	if (!locked) {
+		intr_disable ();
+		kernel_unlock ();
+	}
+}
+
+/* Handler for spurious local APIC interrupts, which must not be
+   acknowledged. */
+static void
+spurious_interrupt (struct intr_frame *f UNUSED) {
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
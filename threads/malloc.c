@@ -1,5 +1,6 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <intrinsic.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
@@ -11,35 +12,53 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   The size of each request, in bytes, is rounded up to one of a
+   set of size classes and assigned to the "descriptor" that
+   manages blocks of that size.  The classes are 16 bytes apart up
+   to 128 bytes and then about 1.25 times apart up to MAX_CLASS, so
+   no block is much bigger than what was asked for, and a lookup
+   table indexed by the size in 16-byte units finds the class at
+   once.
+
+   Blocks come from "arenas", runs of one or more pages obtained
+   from the page allocator, with a header at the start.  An arena
+   for small blocks is a single page; one for larger blocks spans
+   enough pages that the blocks fill it with little left over.
+   The page allocator records the arena as the owner of each of its
+   pages, so that a block can find its arena wherever it lies.
+
+   A new arena is not divided up front: blocks are carved from it
+   with a bump pointer as they are needed.  Each arena keeps its
+   freed blocks on a list of its own, and each descriptor a list of
+   the arenas that have blocks to hand out.  When all of an arena's
+   blocks are free, the arena goes back to the page allocator,
+   unless it is the descriptor's last one.
+
+   Blocks bigger than MAX_CLASS are handled by allocating
+   contiguous pages with the page allocator and sticking the
+   allocation size at the beginning of the allocated block's arena
+   header. */
+
+/* Largest size class. */
+#define MAX_CLASS 8192
+
+/* Most pages in an arena of blocks. */
+#define MAX_ARENA_PAGES 8
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
-	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	size_t arena_pages;         /* Number of pages in an arena. */
+	struct list arenas;         /* Arenas with blocks to hand out. */
+	size_t arena_cnt;           /* Number of arenas. */
+	struct spinlock lock;       /* Lock. */
+
+	/* Statistics. */
+	size_t inuse_cnt;           /* Blocks allocated. */
+	unsigned long long alloc_cnt;       /* Calls to malloc(). */
+	unsigned long long alloc_cycles;    /* Cycles spent in them. */
+	unsigned long long bytes_requested; /* Bytes asked for in them. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -50,39 +69,109 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	struct list_elem elem;      /* Element in descriptor's ARENAS. */
+	struct block *free;         /* Freed blocks. */
+	uint8_t *bump;              /* Next block never handed out. */
+	uint8_t *end;               /* End of the last block. */
 };
 
+/* Offset of the first block in an arena. */
+#define ARENA_HDR_SIZE ROUND_UP (sizeof (struct arena), 16)
+
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	struct block *next;         /* Next free block in arena. */
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Descriptor of each size, in 16-byte units, rounded up. */
+static uint8_t desc_of_size[MAX_CLASS / 16 + 1];
+
+/* Statistics for big blocks, protected by BIG_LOCK. */
+static struct spinlock big_lock;
+static unsigned long long big_cnt;      /* Big blocks allocated. */
+static unsigned long long big_cycles;   /* Cycles spent on them. */
+static size_t big_pages;                /* Pages they hold now. */
+
+static void add_desc (size_t block_size);
 static struct arena *block_to_arena (struct block *);
-static struct block *arena_to_block (struct arena *, size_t idx);
+
+/* Returns the descriptor for blocks of SIZE bytes, which must be
+   between 1 and MAX_CLASS. */
+static inline struct desc *
+size_to_desc (size_t size) {
+	return &descs[desc_of_size[DIV_ROUND_UP (size, 16)]];
+}
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
-
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
-		lock_init (&d->lock);
+	size_t block_size, size;
+	size_t d;
+
+	for (block_size = 16; block_size <= 128; block_size += 16)
+		add_desc (block_size);
+	for (block_size = ROUND_UP (128 * 5 / 4, 16); block_size < MAX_CLASS;
+			block_size = ROUND_UP (block_size * 5 / 4, 16))
+		add_desc (block_size);
+	add_desc (MAX_CLASS);
+
+	d = 0;
+	for (size = 0; size <= MAX_CLASS; size += 16) {
+		while (descs[d].block_size < size)
+			d++;
+		desc_of_size[size / 16] = d;
 	}
+	spin_init (&big_lock);
+}
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes, choosing the
+   fewest pages per arena that leave no more than an eighth of the
+   arena unused, or else the least wasteful. */
+static void
+add_desc (size_t block_size) {
+	struct desc *d = &descs[desc_cnt++];
+	size_t pages, best_pages = 1, best_waste = SIZE_MAX;
+
+	ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+
+	for (pages = 1; pages <= MAX_ARENA_PAGES; pages++) {
+		size_t usable = pages * PGSIZE - ARENA_HDR_SIZE;
+		size_t waste;
+
+		if (usable < block_size)
+			continue;
+		waste = usable % block_size + ARENA_HDR_SIZE;
+		if (waste * 8 <= pages * PGSIZE) {
+			best_pages = pages;
+			break;
+		}
+		if (waste * best_pages < best_waste * pages) {
+			best_pages = pages;
+			best_waste = waste;
+		}
+	}
+
+	d->block_size = block_size;
+	d->arena_pages = best_pages;
+	d->blocks_per_arena = (best_pages * PGSIZE - ARENA_HDR_SIZE) / block_size;
+	list_init (&d->arenas);
+	d->arena_cnt = 0;
+	spin_init (&d->lock);
+	d->inuse_cnt = 0;
+	d->alloc_cnt = 0;
+	d->alloc_cycles = 0;
+	d->bytes_requested = 0;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	uint64_t start = rdtsc ();
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
@@ -91,12 +180,7 @@ malloc (size_t size) {
 	if (size == 0)
 		return NULL;
 
-	/* Find the smallest descriptor that satisfies a SIZE-byte
-	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_CLASS) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -109,37 +193,63 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		palloc_set_owner (a, page_cnt, a);
+
+		spin_lock (&big_lock);
+		big_cnt++;
+		big_pages += page_cnt;
+		big_cycles += rdtsc () - start;
+		spin_unlock (&big_lock);
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	d = size_to_desc (size);
+
+	spin_lock (&d->lock);
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+	/* If no arena has a block to spare, create a new arena. */
+	if (list_empty (&d->arenas)) {
+		spin_unlock (&d->lock);
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
+		/* Allocate its pages. */
+		a = palloc_get_multiple (0, d->arena_pages);
+		if (a == NULL)
 			return NULL;
-		}
+		palloc_set_owner (a, d->arena_pages, a);
 
-		/* Initialize arena and add its blocks to the free list. */
+		/* Initialize arena.  Its blocks are carved out lazily. */
 		a->magic = ARENA_MAGIC;
 		a->desc = d;
 		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+		a->free = NULL;
+		a->bump = (uint8_t *) a + ARENA_HDR_SIZE;
+		a->end = a->bump + d->blocks_per_arena * d->block_size;
+
+		spin_lock (&d->lock);
+		list_push_front (&d->arenas, &a->elem);
+		d->arena_cnt++;
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
+	/* Get a block from the first arena that has one and return it:
+	   a freed block if there is one, otherwise a new one. */
+	a = list_entry (list_front (&d->arenas), struct arena, elem);
+	if (a->free != NULL) {
+		b = a->free;
+		a->free = b->next;
+	} else {
+		ASSERT (a->bump < a->end);
+		b = (struct block *) a->bump;
+		a->bump += d->block_size;
+	}
+	if (--a->free_cnt == 0)
+		list_remove (&a->elem);
+	d->inuse_cnt++;
+	d->alloc_cnt++;
+	d->bytes_requested += size;
+	d->alloc_cycles += rdtsc () - start;
+	spin_unlock (&d->lock);
 	return b;
 }
 
@@ -152,7 +262,7 @@ calloc (size_t a, size_t b) {
 
 	/* Calculate block size and make sure it fits in size_t. */
 	size = a * b;
-	if (size < a || size < b)
+	if (b != 0 && size / b != a)
 		return NULL;
 
 	/* Allocate and zero memory. */
@@ -184,6 +294,11 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
+	} else if (old_block != NULL && new_size <= block_size (old_block)
+			&& (new_size > MAX_CLASS
+				|| size_to_desc (new_size) == block_to_arena (old_block)->desc)) {
+		/* Still the right size class: keep the block. */
+		return old_block;
 	} else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
@@ -207,42 +322,92 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			bool release = false;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			spin_lock (&d->lock);
+
+			/* Add block to its arena's free list. */
+			b->next = a->free;
+			a->free = b;
+			if (a->free_cnt++ == 0)
+				list_push_front (&d->arenas, &a->elem);
+			d->inuse_cnt--;
+
+			/* If the arena is now entirely unused, free it, unless
+			   it is the last one. */
+			if (a->free_cnt == d->blocks_per_arena && d->arena_cnt > 1) {
+				list_remove (&a->elem);
+				d->arena_cnt--;
+				release = true;
 			}
 
-			lock_release (&d->lock);
+			spin_unlock (&d->lock);
+
+			if (release)
+				palloc_free_multiple (a, d->arena_pages);
 		} else {
 			/* It's a big block.  Free its pages. */
+			spin_lock (&big_lock);
+			big_pages -= a->free_cnt;
+			spin_unlock (&big_lock);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
-
+
+/* Fills in *STATS with malloc() statistics so far. */
+void
+malloc_get_stats (struct malloc_stats *stats) {
+	size_t i;
+
+	memset (stats, 0, sizeof *stats);
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+
+		spin_lock (&d->lock);
+		stats->alloc_cnt += d->alloc_cnt;
+		stats->alloc_cycles += d->alloc_cycles;
+		stats->bytes_requested += d->bytes_requested;
+		stats->bytes_allocated += d->alloc_cnt * d->block_size;
+		stats->bytes_live += d->inuse_cnt * d->block_size;
+		stats->arena_bytes += d->arena_cnt * d->arena_pages * PGSIZE;
+		spin_unlock (&d->lock);
+	}
+	spin_lock (&big_lock);
+	stats->alloc_cnt += big_cnt;
+	stats->alloc_cycles += big_cycles;
+	stats->big_pages = big_pages;
+	spin_unlock (&big_lock);
+}
+
+/* Prints malloc() statistics: the average cost of a call, the
+   share of the bytes handed out in size classes beyond what was
+   asked for, and how much of the arenas live blocks use. */
+void
+malloc_print_stats (void) {
+	struct malloc_stats s;
+
+	malloc_get_stats (&s);
+	printf ("Malloc: %llu allocations, %llu cycles each, "
+			"%llu%% rounding waste, %zu of %zu arena bytes in use, "
+			"%zu pages in big blocks\n",
+			s.alloc_cnt, s.alloc_cnt ? s.alloc_cycles / s.alloc_cnt : 0,
+			s.bytes_allocated
+			? (s.bytes_allocated - s.bytes_requested) * 100 / s.bytes_allocated
+			: 0,
+			s.bytes_live, s.arena_bytes, s.big_pages);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
-	struct arena *a = pg_round_down (b);
+	struct arena *a = palloc_get_owner (b);
 
 	/* Check that the arena is valid. */
 	ASSERT (a != NULL);
@@ -250,19 +415,9 @@ block_to_arena (struct block *b) {
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+			|| ((uint8_t *) b - (uint8_t *) a - ARENA_HDR_SIZE)
+				% a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || (struct arena *) b == a + 1);
 
 	return a;
 }
-
-/* Returns the (IDX - 1)'th block within arena A. */
-static struct block *
-arena_to_block (struct arena *a, size_t idx) {
-	ASSERT (a != NULL);
-	ASSERT (a->magic == ARENA_MAGIC);
-	ASSERT (idx < a->desc->blocks_per_arena);
-	return (struct block *) ((uint8_t *) a
-			+ sizeof *a
-			+ idx * a->desc->block_size);
-}
@@ -2,90 +2,132 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 // #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Shifts of the virtual address bits that index the page map
+   level 4, the page directory pointer table, the page directory
+   and the page table, in walk order.  An entry at level L maps
+   1 << level_shift[L] bytes. */
+static const unsigned level_shift[] = {
+	PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT
+};
+#define LEVEL_CNT 4
+
+/* Replaces the large page of SIZE bytes that ENTRY maps by a
+ * table whose entries map the same memory with the same flags,
+ * in pages a level smaller, so that part of it can be remapped.
+ * Returns the new table, or a null pointer if out of memory. */
 static uint64_t *
-pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
-	int idx = PDX (va);
-	if (pdp) {
-		uint64_t *pte = (uint64_t *) pdp[idx];
-		if (!((uint64_t) pte & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page)
-					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-				else
-					return NULL;
-			} else
-				return NULL;
-		}
-		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
-	}
-	return NULL;
+split_large (uint64_t *entry, size_t size) {
+	uint64_t *table = palloc_get_page (0);
+	size_t sub_size = size / (PGSIZE / sizeof *table);
+	uint64_t flags = *entry & PTE_FLAGS;
+
+	if (table == NULL)
+		return NULL;
+	if (sub_size == PGSIZE)
+		flags &= ~PTE_PS;
+	for (unsigned i = 0; i < PGSIZE / sizeof *table; i++)
+		table[i] = (PTE_ADDR (*entry) + i * sub_size) | flags;
+	*entry = vtop (table) | PTE_U | PTE_W | PTE_P;
+	return table;
 }
 
+/* Walks PML4 down to the entry that maps virtual address VA.
+ * With CREATE, descends to the level whose entries map pages of
+ * SIZE bytes, allocating missing tables and splitting larger
+ * pages on the way; if a table cannot be allocated, the tables
+ * allocated so far are freed and a null pointer is returned.
+ * Without CREATE, stops at the first entry that maps a page,
+ * large or not, and stores that page's size in *SIZE if SIZE is
+ * nonnull; returns a null pointer if no table leads there. */
 static uint64_t *
-pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
-	uint64_t *pte = NULL;
-	int idx = PDPE (va);
-	int allocated = 0;
-	if (pdpe) {
-		uint64_t *pde = (uint64_t *) pdpe[idx];
-		if (!((uint64_t) pde & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page) {
-					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-					allocated = 1;
-				} else
-					return NULL;
-			} else
-				return NULL;
+walk (uint64_t *pml4, const uint64_t va, bool create, size_t *size) {
+	uint64_t *allocated[LEVEL_CNT];
+	size_t alloc_cnt = 0;
+	uint64_t *table = pml4;
+
+	if (pml4 == NULL)
+		return NULL;
+	for (unsigned level = 0; ; level++) {
+		uint64_t *entry = &table[(va >> level_shift[level]) & 0x1FF];
+		size_t entry_size = 1UL << level_shift[level];
+
+		if (create ? entry_size == *size
+				: level == LEVEL_CNT - 1 || (*entry & PTE_PS)) {
+			if (size != NULL)
+				*size = entry_size;
+			return entry;
 		}
-		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
+
+		if (*entry & PTE_PS) {
+			table = split_large (entry, entry_size);
+			if (table == NULL)
+				break;
+		} else if (*entry & PTE_P)
+			table = ptov (PTE_ADDR (*entry));
+		else if (create) {
+			table = palloc_get_page (PAL_ZERO);
+			if (table == NULL)
+				break;
+			*entry = vtop (table) | PTE_U | PTE_W | PTE_P;
+			allocated[alloc_cnt++] = entry;
+		} else
+			return NULL;
 	}
-	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
-		pdpe[idx] = 0;
+
+	/* Out of memory: undo the tables we added. */
+	while (alloc_cnt-- > 0) {
+		uint64_t *entry = allocated[alloc_cnt];
+		palloc_free_page (ptov (PTE_ADDR (*entry)));
+		*entry = 0;
 	}
-	return pte;
+	return NULL;
 }
 
 /* Returns the address of the page table entry for virtual
  * address VADDR in page map level 4, pml4.
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
- * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * created and a pointer into it is returned, splitting a large
+ * page that covers VADDR if need be.  Otherwise, a null pointer
+ * is returned.  Without CREATE, if VADDR lies in a large page,
+ * the PDE or PDPE that maps it is returned instead; use
+ * pml4e_lookup() to learn which. */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
-	uint64_t *pte = NULL;
-	int idx = PML4 (va);
-	int allocated = 0;
-	if (pml4e) {
-		uint64_t *pdpe = (uint64_t *) pml4e[idx];
-		if (!((uint64_t) pdpe & PTE_P)) {
-			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
-				if (new_page) {
-					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
-					allocated = 1;
-				} else
-					return NULL;
-			} else
-				return NULL;
-		}
-		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
-	}
-	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
-		pml4e[idx] = 0;
-	}
-	return pte;
+	size_t size = PGSIZE;
+	return walk (pml4e, va, create, create ? &size : NULL);
+}
+
+/* Returns the address of the entry in PML4 that maps virtual
+ * address VA, which may be a PTE, or a PDE or PDPE with PTE_PS,
+ * and stores the size of the page it maps in *SIZE.  Returns a
+ * null pointer if PML4 has no table that leads to such an
+ * entry. */
+uint64_t *
+pml4e_lookup (uint64_t *pml4, const uint64_t va, size_t *size) {
+	ASSERT (size != NULL);
+	return walk (pml4, va, false, size);
+}
+
+/* Returns the address of the entry in PML4 that maps virtual
+ * address VA with a page of SIZE bytes: a PTE if SIZE is PGSIZE,
+ * a PDE if it is LARGE_PGSIZE, or a PDPE if it is HUGE_PGSIZE.
+ * Tables are created as needed, and a larger page covering VA is
+ * split.  Returns a null pointer if out of memory.  The caller
+ * sets PTE_PS in a large entry it fills in. */
+uint64_t *
+pml4e_walk_size (uint64_t *pml4, const uint64_t va, size_t size) {
+	ASSERT (size == PGSIZE || size == LARGE_PGSIZE || size == HUGE_PGSIZE);
+	ASSERT (va % size == 0);
+	return walk (pml4, va, true, &size);
 }
 
 /* Creates a new page map level 4 (pml4) has mappings for kernel
@@ -122,7 +164,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (pdp[i] & PTE_PS) {
+			/* A 2 MB page: FUNC gets its PDE. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -135,7 +184,13 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if (pdp[i] & PTE_PS) {
+			/* A 1 GB page: FUNC gets its PDPE. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) i << PDPESHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pde) & PTE_P)
 			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
 					 aux, pml4_index, i))
 				return false;
@@ -143,7 +198,9 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * A large page is passed to FUNC once, as its PDE or PDPE, with
+ * the address of its start; test for PTE_PS to tell. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -169,7 +226,10 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (pdp[i] & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte),
+					LARGE_PGSIZE / PGSIZE);
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -179,7 +239,10 @@ static void
 pdpe_destroy (uint64_t *pdpe) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if (pdpe[i] & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pde),
+					HUGE_PGSIZE / PGSIZE);
+		else if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
 	palloc_free_page ((void *) pdpe);
@@ -203,7 +266,22 @@ pml4_destroy (uint64_t *pml4) {
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = cpu_current ();
+
+	c->pml4 = pml4 ? pml4 : base_pml4;
+	lcr3 (vtop (c->pml4));
+	intr_set_level (old_level);
+}
+
+/* Drops VA's translation in PML4 from the TLB of every CPU that
+   has PML4 loaded.  The process that owns PML4 may be running on
+   another CPU while this one evicts or scans its pages. */
+static void
+tlb_invalidate (uint64_t *pml4, uint64_t va) {
+	if (rcr3 () == vtop (pml4))
+		invlpg (va);
+	cpu_tlb_shootdown (pml4);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -214,10 +292,12 @@ void *
 pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	ASSERT (is_user_vaddr (uaddr));
 
-	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
+	size_t size;
+	uint64_t *pte = pml4e_lookup (pml4, (uint64_t) uaddr, &size);
 
 	if (pte && (*pte & PTE_P))
-		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+		return ptov (PTE_ADDR (*pte) & ~(size - 1))
+			+ ((uint64_t) uaddr & (size - 1));
 	return NULL;
 }
 
@@ -243,6 +323,26 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Like pml4_set_page(), but maps the 2 MB user virtual page UPAGE
+ * to the 2 MB frame at kernel virtual address KPAGE with a single
+ * PDE.  No part of UPAGE may already be mapped.  Returns true if
+ * successful, false if memory allocation failed or UPAGE already
+ * has a page table. */
+bool
+pml4_set_large_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT ((uint64_t) upage % LARGE_PGSIZE == 0);
+	ASSERT (vtop (kpage) % LARGE_PGSIZE == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_size (pml4, (uint64_t) upage, LARGE_PGSIZE);
+
+	if (pde == NULL || (*pde & PTE_P))
+		return false;
+	*pde = vtop (kpage) | PTE_P | PTE_PS | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -257,8 +357,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, (uint64_t) upage);
 	}
 }
 
@@ -283,8 +382,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, (uint64_t) vpage);
 	}
 }
 
@@ -309,7 +407,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, (uint64_t) vpage);
 	}
 }
@@ -9,7 +9,9 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,24 +26,81 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages are kept
+   as blocks of 2**ORDER pages, aligned to their size in physical
+   memory, on one free list per order.  An allocation takes the
+   smallest block that is big enough, splitting it in halves as
+   needed, and a freed block is merged with its "buddy", the other
+   half of the block of twice the size, for as long as the buddy is
+   free too.  Both take O(log n) steps.  A request for a number of
+   pages that is not a power of two gives back the unused tail of
+   its block at once.
+
+   The free lists are threaded through an array of list elements
+   outside the pages themselves, since the pool is set up before
+   all of memory is mapped.  Each pool's lock is a spinlock, since
+   the scheduler frees the pages of dead threads with interrupts
+   off, and it is held only for those few steps. */
+
+/* Largest block, as a power of two of pages (1 GB). */
+#define MAX_ORDER 18
+
+/* ORDER_MAP value of a page that does not start a free block. */
+#define NOT_FREE 0xff
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct spinlock lock;           /* Mutual exclusion. */
+	struct bitmap *used_map;        /* Bitmap of pages in use. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t page_cnt;                /* Number of pages in pool. */
+	size_t free_cnt;                /* Number of free pages. */
+	struct list free_lists[MAX_ORDER + 1];  /* Free blocks, by order. */
+	struct list_elem *links;        /* Free list element, by page. */
+	uint8_t *order_map;             /* Order of free block, by first page. */
+	void **owners;                  /* Owner of allocated page, by page. */
+
+	/* Pages zeroed ahead of time by the idle thread.  They are
+	   allocated as far as the free lists are concerned, and linked
+	   through LINKS. */
+	struct list zeroed;             /* Pre-zeroed pages. */
+	size_t zeroed_cnt;              /* Number of pages in ZEROED. */
+	bool refilling;                 /* Zeroing until the high watermark? */
+	unsigned long long zero_hits;   /* PAL_ZERO pages from ZEROED. */
+	unsigned long long zero_misses; /* PAL_ZERO pages zeroed on demand. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Physical memory mapped by the page tables that start.S builds.
+   Pages above it cannot be written, so they are not put in the
+   free lists until palloc_init_high(). */
+#define BOOT_MAP_END 0x10000000
+
+/* Lowest kernel virtual address of a page that may be freed:
+   everything below holds the kernel and the pools' maps. */
+static uint64_t usable_bound;
+
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Watermarks of each pool's pre-zeroed pages: once there are no
+   more than the low one, the idle thread zeroes pages until there
+   are as many as the high one. */
+size_t palloc_zero_low = 16;
+size_t palloc_zero_high = 64;
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+static void release_memory (uint64_t lo, uint64_t hi);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void *zeroed_get (struct pool *);
+static size_t zeroed_drain (struct pool *);
+static void pool_release (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -190,20 +249,37 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 	// generate the user pool
 	init_pool(&user_pool, &free_start, region_start, end);
 
-	// Iterate over the e820_entry. Setup the usable.
-	uint64_t usable_bound = (uint64_t) free_start;
+	usable_bound = (uint64_t) free_start;
+	release_memory (0, BOOT_MAP_END);
+}
+
+/* Iterates over the e820 entries and frees the usable pages whose
+   physical addresses are between LO and HI into their pools. */
+static void
+release_memory (uint64_t lo, uint64_t hi) {
+	struct multiboot_info *mb_info = ptov (MULTIBOOT_INFO);
+	struct e820_entry *entries = ptov (mb_info->mmap_base);
 	struct pool *pool;
 	void *pool_end;
 	size_t page_idx, page_cnt;
+	uint32_t i;
 
 	for (i = 0; i < mb_info->mmap_len / sizeof (struct e820_entry); i++) {
 		struct e820_entry *entry = &entries[i];
 		if (entry->type == ACPI_RECLAIMABLE || entry->type == USABLE) {
-			uint64_t start = (uint64_t)
-				ptov (APPEND_HILO (entry->mem_hi, entry->mem_lo));
+			uint64_t start = APPEND_HILO (entry->mem_hi, entry->mem_lo);
 			uint64_t size = APPEND_HILO (entry->len_hi, entry->len_lo);
 			uint64_t end = start + size;
 
+			if (start < lo)
+				start = lo;
+			if (end > hi)
+				end = hi;
+			if (start >= end)
+				continue;
+			start = (uint64_t) ptov (start);
+			end = (uint64_t) ptov (end);
+
 			// TODO: add 0x1000 ~ 0x200000, This is not a matter for now.
 			// All the pages are unuable
 			if (end < usable_bound)
@@ -211,6 +287,9 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 
 			start = (uint64_t)
 				pg_round_up (start >= usable_bound ? start : usable_bound);
+			end = (uint64_t) pg_round_down (end);
+			if (start >= end)
+				continue;
 split:
 			if (page_from_pool (&kernel_pool, (void *) start))
 				pool = &kernel_pool;
@@ -219,16 +298,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_release (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -253,6 +332,14 @@ palloc_init (void) {
 	return ext_mem.end;
 }
 
+/* Frees the pages that the boot page tables do not map into the
+   pools.  Must be called once paging_init() has mapped all of
+   physical memory. */
+void
+palloc_init_high (void) {
+	release_memory (BOOT_MAP_END, UINT64_MAX - KERN_BASE);
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -263,11 +350,37 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	if (page_cnt == 0)
+		return NULL;
+
+	/* A single zeroed page may have been zeroed ahead of time. */
+	if ((flags & PAL_ZERO) && page_cnt == 1) {
+		void *page = zeroed_get (pool);
+		if (page != NULL)
+			return page;
+	}
+
+	spin_lock (&pool->lock);
+	size_t page_idx = pool_alloc (pool, page_cnt);
+	spin_unlock (&pool->lock);
 	void *pages;
 
+	/* Out of pages: take back the pre-zeroed pages and, for the
+	   kernel pool, the pages cached for new threads and the empty
+	   slabs of object caches, and try again, unless the caller
+	   would rather do without. */
+	if (page_idx == BITMAP_ERROR && !(flags & PAL_NORECLAIM)) {
+		size_t reclaimed = zeroed_drain (pool);
+
+		if (pool == &kernel_pool)
+			reclaimed += thread_cache_shrink () + kmem_cache_reap ();
+		if (reclaimed > 0) {
+			spin_lock (&pool->lock);
+			page_idx = pool_alloc (pool, page_cnt);
+			spin_unlock (&pool->lock);
+		}
+	}
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
@@ -318,8 +431,10 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	spin_lock (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_release (pool, page_idx, page_cnt);
+	spin_unlock (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +443,314 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the pool that PAGE belongs to. */
+static struct pool *
+pool_of (const void *page) {
+	if (page_from_pool (&kernel_pool, (void *) page))
+		return &kernel_pool;
+	else if (page_from_pool (&user_pool, (void *) page))
+		return &user_pool;
+	else
+		NOT_REACHED ();
+}
+
+/* Records OWNER as the owner of the PAGE_CNT allocated pages
+   starting at PAGES, for palloc_get_owner().  An allocator that
+   carves objects out of runs of pages can use it to find the run
+   that holds an object from any of its pages. */
+void
+palloc_set_owner (void *pages, size_t page_cnt, void *owner) {
+	struct pool *pool = pool_of (pages);
+	size_t page_idx = pg_no (pages) - pg_no (pool->base);
+	size_t i;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	for (i = 0; i < page_cnt; i++)
+		pool->owners[page_idx + i] = owner;
+}
+
+/* Returns the owner last recorded for allocated PAGE, which may be
+   any address within the page. */
+void *
+palloc_get_owner (const void *page) {
+	struct pool *pool = pool_of (page);
+	return pool->owners[pg_no (page) - pg_no (pool->base)];
+}
+
+/* Returns the number of free pages in the pool PAL_USER in FLAGS
+   selects, and stores the size of its largest free block, in
+   pages, in *LARGEST if it is nonnull. */
+size_t
+palloc_count_free (enum palloc_flags flags, size_t *largest) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t free_cnt;
+
+	spin_lock (&pool->lock);
+	free_cnt = pool->free_cnt;
+	if (largest != NULL) {
+		int order;
+
+		*largest = 0;
+		for (order = MAX_ORDER; order >= 0; order--)
+			if (!list_empty (&pool->free_lists[order])) {
+				*largest = (size_t) 1 << order;
+				break;
+			}
+	}
+	spin_unlock (&pool->lock);
+	return free_cnt;
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	size_t kernel_largest, user_largest;
+	size_t kernel_free = palloc_count_free (0, &kernel_largest);
+	size_t user_free = palloc_count_free (PAL_USER, &user_largest);
+
+	printf ("Pages: kernel %zu of %zu free (largest block %zu), "
+			"user %zu of %zu free (largest block %zu)\n",
+			kernel_free, kernel_pool.page_cnt, kernel_largest,
+			user_free, user_pool.page_cnt, user_largest);
+	printf ("Zeroed pages: kernel %zu ready, %llu hits, %llu misses; "
+			"user %zu ready, %llu hits, %llu misses\n",
+			kernel_pool.zeroed_cnt, kernel_pool.zero_hits,
+			kernel_pool.zero_misses, user_pool.zeroed_cnt,
+			user_pool.zero_hits, user_pool.zero_misses);
+}
+
+/* Stores the number of pre-zeroed pages ready in the pool
+   PAL_USER in FLAGS selects in *READY, and the number of PAL_ZERO
+   page allocations that did and did not find one in *HITS and
+   *MISSES. */
+void
+palloc_zero_counts (enum palloc_flags flags, size_t *ready,
+		unsigned long long *hits, unsigned long long *misses) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	spin_lock (&pool->lock);
+	*ready = pool->zeroed_cnt;
+	*hits = pool->zero_hits;
+	*misses = pool->zero_misses;
+	spin_unlock (&pool->lock);
+}
+
+/* Zeroes PAGE with non-temporal stores, which go around the
+   caches so as not to push out what the next thread will use. */
+static void
+zero_page_nt (void *page) {
+	uint64_t *p = page;
+	uint64_t *end = p + PGSIZE / sizeof *p;
+
+	for (; p < end; p += 4)
+		asm volatile ("movnti %1, (%0); movnti %1, 8(%0);"
+				"movnti %1, 16(%0); movnti %1, 24(%0)"
+				: : "r" (p), "r" (0UL) : "memory");
+	asm volatile ("sfence" : : : "memory");
+}
+
+/* Takes a page from POOL's pre-zeroed pages and returns it, or
+   returns a null pointer if there are none.  Counts the hit or
+   miss. */
+static void *
+zeroed_get (struct pool *pool) {
+	void *page = NULL;
+
+	spin_lock (&pool->lock);
+	if (!list_empty (&pool->zeroed)) {
+		size_t page_idx = list_pop_front (&pool->zeroed) - pool->links;
+
+		page = pool->base + PGSIZE * page_idx;
+		pool->zeroed_cnt--;
+		pool->zero_hits++;
+	} else
+		pool->zero_misses++;
+	if (pool->zeroed_cnt <= palloc_zero_low)
+		pool->refilling = true;
+	spin_unlock (&pool->lock);
+	return page;
+}
+
+/* Returns POOL's pre-zeroed pages to its free lists.  Returns the
+   number of pages. */
+static size_t
+zeroed_drain (struct pool *pool) {
+	size_t cnt;
+
+	spin_lock (&pool->lock);
+	cnt = pool->zeroed_cnt;
+	while (!list_empty (&pool->zeroed)) {
+		size_t page_idx = list_pop_front (&pool->zeroed) - pool->links;
+		pool_release (pool, page_idx, 1);
+	}
+	pool->zeroed_cnt = 0;
+	spin_unlock (&pool->lock);
+	return cnt;
+}
+
+/* Zeroes one page for POOL's pre-zeroed pages, if it is below its
+   high watermark and has free pages to spare.  Returns true if it
+   did. */
+static bool
+zero_one (struct pool *pool) {
+	size_t page_idx = BITMAP_ERROR;
+
+	spin_lock (&pool->lock);
+	if (pool->refilling && pool->zeroed_cnt < palloc_zero_high
+			&& pool->free_cnt > palloc_zero_high)
+		page_idx = pool_alloc (pool, 1);
+	else
+		pool->refilling = false;
+	spin_unlock (&pool->lock);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	zero_page_nt (pool->base + PGSIZE * page_idx);
+
+	spin_lock (&pool->lock);
+	list_push_front (&pool->zeroed, &pool->links[page_idx]);
+	pool->zeroed_cnt++;
+	spin_unlock (&pool->lock);
+	return true;
+}
+
+/* Zeroes a page ahead of time for PAL_ZERO allocations from the
+   kernel or the user pool, whichever needs one.  Returns true if
+   it did, false if both have enough.  Called by the idle thread
+   with interrupts on and without the big kernel lock. */
+bool
+palloc_zero_idle (void) {
+	return zero_one (&kernel_pool) || zero_one (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's used_map at its base, followed by the
+     free list elements, the order and the owner of each page.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t links_pages = ROUND_UP (pgcnt * sizeof *p->links, PGSIZE);
+	size_t order_pages = ROUND_UP (pgcnt, PGSIZE);
+	size_t owner_pages = ROUND_UP (pgcnt * sizeof *p->owners, PGSIZE);
+	int order;
 
-	lock_init(&p->lock);
+	spin_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->page_cnt = pgcnt;
+	p->free_cnt = 0;
+	for (order = 0; order <= MAX_ORDER; order++)
+		list_init (&p->free_lists[order]);
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
+	p->refilling = true;
+	p->zero_hits = p->zero_misses = 0;
+	p->links = (struct list_elem *) ((uint8_t *) *bm_base + bm_pages);
+	p->order_map = (uint8_t *) p->links + links_pages;
+	p->owners = (void **) (p->order_map + order_pages);
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->order_map, NOT_FREE, pgcnt);
+
+	*bm_base += bm_pages + links_pages + order_pages + owner_pages;
+}
+
+/* Returns the page number in physical memory of POOL's page
+   PAGE_IDX, which determines the alignment of blocks. */
+static inline size_t
+pool_pfn (const struct pool *pool, size_t page_idx) {
+	return vtop (pool->base) / PGSIZE + page_idx;
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX in POOL to its
+   free list, first merging it with its buddy for as long as the
+   buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	while (order < MAX_ORDER) {
+		size_t buddy_pfn = pool_pfn (pool, page_idx) ^ ((size_t) 1 << order);
+		size_t buddy_idx;
+
+		if (buddy_pfn < pool_pfn (pool, 0))
+			break;
+		buddy_idx = buddy_pfn - pool_pfn (pool, 0);
+		if (buddy_idx >= pool->page_cnt || pool->order_map[buddy_idx] != order)
+			break;
+
+		list_remove (&pool->links[buddy_idx]);
+		pool->order_map[buddy_idx] = NOT_FREE;
+		if (buddy_idx < page_idx)
+			page_idx = buddy_idx;
+		order++;
+	}
+	pool->order_map[page_idx] = order;
+	list_push_front (&pool->free_lists[order], &pool->links[page_idx]);
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX in POOL to its free
+   lists, as the largest aligned blocks that make them up. */
+static void
+pool_release (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool->free_cnt += page_cnt;
+	while (page_cnt > 0) {
+		size_t pfn = pool_pfn (pool, page_idx);
+		int order = 0;
+
+		while (order < MAX_ORDER && (pfn & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is big
+   enough.  The smallest free block that fits is split, to keep
+   the large ones whole. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx, block_cnt;
+	int order, want = 0;
+
+	while (((size_t) 1 << want) < page_cnt)
+		if (++want > MAX_ORDER)
+			return BITMAP_ERROR;
+	for (order = want; order <= MAX_ORDER; order++)
+		if (!list_empty (&pool->free_lists[order]))
+			break;
+	if (order > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_pop_front (&pool->free_lists[order]) - pool->links;
+	pool->order_map[page_idx] = NOT_FREE;
+
+	/* Split off the upper halves that we do not need. */
+	while (order > want) {
+		size_t buddy_idx;
+
+		order--;
+		buddy_idx = page_idx + ((size_t) 1 << order);
+		pool->order_map[buddy_idx] = order;
+		list_push_front (&pool->free_lists[order], &pool->links[buddy_idx]);
+	}
+	block_cnt = (size_t) 1 << order;
+	pool->free_cnt -= block_cnt;
+
+	/* Give back the tail beyond PAGE_CNT. */
+	if (block_cnt > page_cnt)
+		pool_release (pool, page_idx + page_cnt, block_cnt - page_cnt);
 
-	*bm_base += bm_pages;
+	ASSERT (!bitmap_any (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	return page_idx;
 }
 
 /* Returns true if PAGE was allocated from POOL,
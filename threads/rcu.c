@@ -0,0 +1,131 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Callbacks passed to call_rcu() that wait for a grace period to
+   start.  Protected by disabling interrupts. */
+static struct list rcu_pending;
+
+/* Runs the pending callbacks after a grace period. */
+static struct work rcu_work;
+static work_func rcu_process_callbacks;
+
+/* Initializes RCU.  Must be called after workqueue_init(). */
+void
+rcu_init (void) {
+	list_init (&rcu_pending);
+	work_init (&rcu_work, rcu_process_callbacks, NULL);
+}
+
+/* Begins an RCU read-side critical section.  Until the matching
+   rcu_read_unlock(), the running thread must not block, and is
+   not preempted: a preemption that falls due is put off until
+   then.  Sections may nest, and may be entered from interrupt
+   handlers. */
+void
+rcu_read_lock (void) {
+	thread_current ()->rcu_nesting++;
+	barrier ();
+}
+
+/* Ends an RCU read-side critical section, yielding the CPU if it
+   put off a preemption. */
+void
+rcu_read_unlock (void) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t->rcu_nesting > 0);
+
+	barrier ();
+	if (--t->rcu_nesting == 0 && t->rcu_yield) {
+		t->rcu_yield = false;
+		if (intr_context ())
+			intr_yield_on_return ();
+		else
+			thread_yield ();
+	}
+}
+
+/* Waits until every RCU read-side critical section that was in
+   progress when it was called has ended.  Must not be called from
+   an interrupt handler or in a read-side critical section.
+
+   The calling CPU is quiescent as it is, since readers cannot be
+   preempted, so only the other CPUs need to go through the
+   scheduler, or be idle. */
+void
+synchronize_rcu (void) {
+	struct cpu *self = cpu_current ();
+	uint64_t snap[CPU_MAX];
+	unsigned i;
+
+	ASSERT (!intr_context ());
+	ASSERT (thread_current ()->rcu_nesting == 0);
+
+	for (i = 0; i < cpu_cnt; i++)
+		snap[i] = *(volatile uint64_t *) &cpus[i].rcu_qs;
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c == self)
+			continue;
+		while (*(volatile uint64_t *) &c->rcu_qs == snap[i]
+				&& *(struct thread * volatile *) &c->curr != c->idle_thread)
+			timer_sleep (1);
+	}
+}
+
+/* Calls FUNC on HEAD, in a kernel thread, once every RCU
+   read-side critical section in progress has ended.  Typically
+   FUNC frees the structure that HEAD is embedded in.  May be
+   called from an interrupt handler. */
+void
+call_rcu (struct rcu_head *head, rcu_func *func) {
+	enum intr_level old_level;
+
+	ASSERT (head != NULL);
+	ASSERT (func != NULL);
+
+	head->func = func;
+	old_level = intr_disable ();
+	list_push_back (&rcu_pending, &head->elem);
+	intr_set_level (old_level);
+	queue_work (system_wq, &rcu_work);
+}
+
+/* Waits until the callbacks of every call_rcu() made before the
+   call have run.  Must not be called by a system workqueue
+   worker. */
+void
+rcu_barrier (void) {
+	flush_workqueue (system_wq);
+}
+
+/* Takes the callbacks pending so far, waits for a grace period,
+   and runs them.  Callbacks added meanwhile queue the work again,
+   and wait for a later grace period. */
+static void
+rcu_process_callbacks (struct work *work UNUSED) {
+	struct list batch;
+	enum intr_level old_level;
+
+	list_init (&batch);
+	old_level = intr_disable ();
+	list_splice (list_end (&batch), list_begin (&rcu_pending),
+			list_end (&rcu_pending));
+	intr_set_level (old_level);
+
+	synchronize_rcu ();
+
+	while (!list_empty (&batch)) {
+		struct rcu_head *head =
+			list_entry (list_pop_front (&batch), struct rcu_head, elem);
+		head->func (head);
+	}
+}
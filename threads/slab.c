@@ -0,0 +1,321 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator, after Bonwick.
+
+   Each cache carves page-sized slabs into equal slots, one per
+   object, with the slab's header at the start of the page.  A free
+   slot holds a pointer to the next free slot of its slab: in the
+   object's first bytes, or just past the object if the cache has a
+   constructor, so as not to disturb the constructed state.
+
+   A cache keeps its slabs on three lists, by whether all, some or
+   none of their objects are free, and allocates from a partly
+   used slab first so that the others can empty out.  A few empty
+   slabs are kept to absorb bursts; the rest go back to the page
+   allocator at once, and kmem_cache_reap() gives back the kept
+   ones too when the kernel pool runs dry.
+
+   Each cache is protected by a spinlock, held only for a few list
+   operations, so objects may be freed with interrupts off. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0bec
+
+/* Empty slabs kept by a cache. */
+#define EMPTY_MAX 2
+
+/* An object cache. */
+struct kmem_cache {
+	struct list_elem elem;          /* Element in `caches'. */
+	char name[16];                  /* Name (for statistics). */
+	struct spinlock lock;           /* Protects the members below. */
+	size_t obj_size;                /* Size of an object. */
+	size_t slot_size;               /* Bytes per object in a slab. */
+	size_t free_ofs;                /* Offset of free pointer in a slot. */
+	size_t slab_capacity;           /* Objects per slab. */
+	kmem_ctor *ctor;                /* Constructor, or NULL. */
+	struct list full;               /* Slabs with no free objects. */
+	struct list partial;            /* Slabs with some free objects. */
+	struct list empty;              /* Slabs with no objects in use. */
+	size_t empty_cnt;               /* Number of slabs in EMPTY. */
+
+	/* Statistics. */
+	size_t slab_cnt;                /* Slabs, in all three lists. */
+	size_t inuse_cnt;               /* Objects allocated. */
+	unsigned long long alloc_cnt;   /* Calls to kmem_cache_alloc(). */
+	unsigned long long free_cnt;    /* Calls to kmem_cache_free(). */
+	unsigned long long reaped_cnt;  /* Empty slabs given back. */
+};
+
+/* A slab, at the start of its page. */
+struct slab {
+	unsigned magic;                 /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;       /* Owning cache. */
+	struct list_elem elem;          /* Element in one of its cache's lists. */
+	size_t inuse;                   /* Objects allocated from it. */
+	void *free;                     /* First free slot, or NULL. */
+};
+
+/* Offset of the first slot in a slab. */
+#define SLAB_HDR_SIZE ROUND_UP (sizeof (struct slab), 16)
+
+/* All caches, for statistics and reaping. */
+static struct list caches;
+static struct spinlock caches_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Returns the free pointer in the slot of OBJ in cache C. */
+static inline void **
+free_ptr (struct kmem_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->free_ofs);
+}
+
+/* Initializes the list of caches. */
+void
+kmem_cache_init (void) {
+	list_init (&caches);
+	spin_init (&caches_lock);
+}
+
+/* Creates a cache named NAME of objects SIZE bytes long, each put
+   through CTOR, if it is nonnull, when its slab is created.
+   Returns the new cache, or a null pointer if memory is exhausted.
+   Caches are never destroyed. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor *ctor) {
+	struct kmem_cache *c;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+	strlcpy (c->name, name, sizeof c->name);
+	spin_init (&c->lock);
+	c->obj_size = size;
+	c->free_ofs = ctor != NULL ? ROUND_UP (size, sizeof (void *)) : 0;
+	c->slot_size = ROUND_UP (c->free_ofs + (ctor != NULL ? sizeof (void *)
+				: size < sizeof (void *) ? sizeof (void *) : size),
+			sizeof (void *));
+	c->slab_capacity = (PGSIZE - SLAB_HDR_SIZE) / c->slot_size;
+	ASSERT (c->slab_capacity > 0);
+	c->ctor = ctor;
+	list_init (&c->full);
+	list_init (&c->partial);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = c->inuse_cnt = 0;
+	c->alloc_cnt = c->free_cnt = c->reaped_cnt = 0;
+
+	spin_lock (&caches_lock);
+	list_push_back (&caches, &c->elem);
+	spin_unlock (&caches_lock);
+	return c;
+}
+
+/* Allocates an object from cache C and returns it, or a null
+   pointer if memory is exhausted. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	spin_lock (&c->lock);
+	if (list_empty (&c->partial)) {
+		if (!list_empty (&c->empty)) {
+			list_push_front (&c->partial, list_pop_front (&c->empty));
+			c->empty_cnt--;
+		} else {
+			/* Grow the cache, without holding its lock. */
+			spin_unlock (&c->lock);
+			s = slab_create (c);
+			if (s == NULL)
+				return NULL;
+			spin_lock (&c->lock);
+			list_push_front (&c->partial, &s->elem);
+			c->slab_cnt++;
+		}
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	obj = s->free;
+	s->free = *free_ptr (c, obj);
+	if (++s->inuse == c->slab_capacity) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->inuse_cnt++;
+	c->alloc_cnt++;
+	spin_unlock (&c->lock);
+	return obj;
+}
+
+/* Allocates an object from cache C, which must not have a
+   constructor, and fills it with zeros.  Returns a null pointer
+   if memory is exhausted. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c) {
+	void *obj;
+
+	ASSERT (c->ctor == NULL);
+
+	obj = kmem_cache_alloc (c);
+	if (obj != NULL)
+		memset (obj, 0, c->obj_size);
+	return obj;
+}
+
+/* Returns OBJ, which must have come from cache C, to C.  May be
+   called with interrupts off. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s, *dead = NULL;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	spin_lock (&c->lock);
+	ASSERT (s->inuse > 0);
+	*free_ptr (c, obj) = s->free;
+	s->free = obj;
+	if (--s->inuse == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			dead = s;
+			c->slab_cnt--;
+			c->reaped_cnt++;
+		}
+	} else if (s->inuse == c->slab_capacity - 1) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	c->inuse_cnt--;
+	c->free_cnt++;
+	spin_unlock (&c->lock);
+
+	if (dead != NULL)
+		palloc_free_page (dead);
+}
+
+/* Gives the empty slabs of cache C back to the page allocator.
+   Returns the number of pages freed. */
+size_t
+kmem_cache_shrink (struct kmem_cache *c) {
+	struct list dead;
+	size_t cnt;
+
+	list_init (&dead);
+	spin_lock (&c->lock);
+	list_splice (list_end (&dead), list_begin (&c->empty), list_end (&c->empty));
+	cnt = c->empty_cnt;
+	c->empty_cnt = 0;
+	c->slab_cnt -= cnt;
+	c->reaped_cnt += cnt;
+	spin_unlock (&c->lock);
+
+	while (!list_empty (&dead))
+		palloc_free_page (list_entry (list_pop_front (&dead), struct slab, elem));
+	return cnt;
+}
+
+/* Gives the empty slabs of every cache back to the page
+   allocator, which calls this when the kernel pool runs out.
+   Returns the number of pages freed. */
+size_t
+kmem_cache_reap (void) {
+	struct list_elem *e;
+	size_t cnt = 0;
+
+	spin_lock (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+		cnt += kmem_cache_shrink (list_entry (e, struct kmem_cache, elem));
+	spin_unlock (&caches_lock);
+	return cnt;
+}
+
+/* Prints statistics for each cache. */
+void
+kmem_cache_print_stats (void) {
+	struct list_elem *e;
+
+	spin_lock (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		printf ("Cache %s: %zu of %zu %zu-byte objects in use, %zu slabs, "
+				"%llu allocs, %llu frees, %llu slabs reaped\n",
+				c->name, c->inuse_cnt, c->slab_cnt * c->slab_capacity,
+				c->obj_size, c->slab_cnt, c->alloc_cnt, c->free_cnt,
+				c->reaped_cnt);
+	}
+	spin_unlock (&caches_lock);
+}
+
+/* Allocates a page for cache C and carves it into a slab of free
+   objects, putting each through C's constructor.  Returns the new
+   slab, or a null pointer if memory is exhausted. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	uint8_t *obj;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->inuse = 0;
+	s->free = NULL;
+
+	/* Link the slots so that the first is handed out first. */
+	obj = (uint8_t *) s + SLAB_HDR_SIZE + (c->slab_capacity - 1) * c->slot_size;
+	for (i = 0; i < c->slab_capacity; i++, obj -= c->slot_size) {
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*free_ptr (c, obj) = s->free;
+		s->free = obj;
+	}
+	return s;
+}
+
+/* Returns the slab that OBJ, from cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT (pg_ofs (obj) >= SLAB_HDR_SIZE);
+	ASSERT ((pg_ofs (obj) - SLAB_HDR_SIZE) % c->slot_size == 0);
+
+	return s;
+}
@@ -29,14 +29,20 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-bool cmp_sema_priority(const struct list_elem *e, const struct list_elem *before, void * aux);
-bool comapare_priority(struct list_elem *element, struct list_elem *before,void * aux);
+static pq_less_func waiter_less;
+static pq_less_func cond_waiter_less;
+static void lock_take (struct lock *);
+static int lock_top_priority (const struct lock *);
+static void spin_push_off (void);
+static void spin_pop_off (void);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,30 +53,12 @@ bool comapare_priority(struct list_elem *element, struct list_elem *before,void
    - up or "V": increment the value (and wake up one waiting
    thread, if any). */
    
-bool cmp_sema_priority(const struct list_elem *e, const struct list_elem *before, void * aux){
-	//struct thread * c= list_entry(list_begin(&(list_entry(e,struct semaphore_elem,elem)->semaphore.waiters)),struct thread,elem)->name;
-	struct semaphore_elem * a = list_entry(e,struct semaphore_elem,elem);
-	struct semaphore_elem * a_before = list_entry(before,struct semaphore_elem,elem);
-
-	struct list_elem * b = list_begin(&(a->semaphore.waiters));
-	struct list_elem * b_before = list_begin(&(a_before->semaphore.waiters));
-
-	struct thread * c = list_entry(b,struct thread,elem);
-	struct thread * c_before = list_entry(b_before,struct thread,elem);
-
-	// return 
-	// char* a = list_entry(list_begin(&(list_entry(e,struct semaphore_elem,elem)->semaphore.waiters)),struct thread,elem)->name;
-	// char* b = list_entry(list_begin(&(list_entry(before,struct semaphore_elem,elem)->semaphore.waiters)),struct thread,elem)->name;
-	// printf("%s", list_entry(list_begin(&(list_entry(e,struct semaphore_elem,elem)->semaphore.waiters)),struct thread,elem)->name);
-	return c->priority > c_before->priority;
-}
-
 void
 sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	pq_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -90,9 +78,21 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		//list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters,&thread_current() ->elem,comapare_priority,NULL);
-		
+		struct thread *cur = thread_current ();
+
+		/* Under the MLFQS, waiters are keyed by their priority as
+		   of when they started waiting, which nothing changes while
+		   they wait, so SEMA's waiters never need reordering. */
+		if (thread_mlfqs)
+			thread_mlfqs_update (cur);
+
+		/* A thread in cond_wait() is keyed by its place among the
+		   condition's waiters instead. */
+		pq_push (&sema->waiters, &cur->wait_elem);
+		if (cur->wait_queue == NULL) {
+			cur->wait_queue = &sema->waiters;
+			cur->wait_key = &cur->wait_elem;
+		}
 		thread_block ();
 	}
 	sema->value--;
@@ -124,26 +124,44 @@ sema_try_down (struct semaphore *sema) {
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up one thread of those waiting for SEMA, if any.  If
+   that thread ranks at least as high as the running thread, the
+   CPU is handed to it directly with thread_yield_to(), unless
+   the caller had interrupts off: code that keeps them off only
+   gives up the CPU to a strictly higher-priority thread.
 
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) {
 	enum intr_level old_level;
+	struct thread *t = NULL;
 
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		list_sort(&sema->waiters, comapare_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+	if (!pq_empty (&sema->waiters)){
+		/* thread_unblock() brings T's MLFQS priority up to date. */
+		t = pq_entry (pq_pop (&sema->waiters), struct thread, wait_elem);
+		if (t->wait_queue == &sema->waiters)
+			t->wait_queue = NULL;
+		thread_unblock (t);
 	}
 
 	sema->value++;
-	thread_test_preemption ();
+	if (t == NULL || intr_context () || old_level == INTR_OFF
+			|| !thread_yield_to (t))
+		thread_test_preemption ();
 	intr_set_level (old_level);
 }
 
+/* Orders the threads waiting on a semaphore by priority. */
+static bool
+waiter_less (const struct pq_elem *a, const struct pq_elem *b,
+		void *aux UNUSED) {
+	return pq_entry (a, struct thread, wait_elem)->priority
+		< pq_entry (b, struct thread, wait_elem)->priority;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -199,6 +217,7 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->priority = PRI_MIN;
 	sema_init (&lock->semaphore, 1);
 }
 
@@ -206,44 +225,38 @@ lock_init (struct lock *lock) {
    necessary.  The lock must not already be held by the current
    thread.
 
+   If LOCK is held, the current thread's priority is donated to
+   its holder, and on down the chain of locks the holders wait
+   for, as far as it raises anyone's priority.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-bool
-compare_donation_priority (struct list_elem *cur, struct list_elem *before, void *aux)
-{
-	return list_entry (cur, struct thread, d_elem)->priority > list_entry (before, struct thread, d_elem)->priority;
-}
 void
 lock_acquire (struct lock *lock) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
-	struct thread *cur = thread_current();
-	if(!thread_mlfqs){
-	if(lock->holder){ 
-		// if(lock->holder->priority > cur->priority){ // lock->holder와 현재 스레드간의 priority 비교는 필수인지
-		// }
+
+	old_level = intr_disable ();
+	if (!thread_mlfqs && lock->holder != NULL) {
 		cur->wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations, &cur->d_elem, compare_donation_priority, NULL);
-		//list_insert_ordered(&(thread_current()->wait_on_lock->holder->donations), &(thread_current()->d_elem),compare_donation_priority,NULL);
-		
-		// while(cur->wait_on_lock){ // wait_on_lock이 존재한다면,
-		// 	cur->wait_on_lock->holder->priority = cur->priority;
-		// 	cur = cur->wait_on_lock->holder;
-		// }
-		struct thread *start = thread_current();
-		while(start->wait_on_lock){ // wait_on_lock이 존재한다면 재귀 수행 -> nested donation!
-			struct thread *holder = start->wait_on_lock->holder;
-			holder->priority = start->priority;
-			start = holder;
+
+		/* We are about to become one of LOCK's waiters. */
+		if (cur->priority > lock->priority) {
+			lock->priority = cur->priority;
+			pq_update (&lock->holder->held_locks, &lock->elem);
+			lock_update_donation (lock->holder);
 		}
 	}
-	}
 	sema_down (&lock->semaphore);
-	lock->holder = cur;
 	cur->wait_on_lock = NULL;
+	lock_take (lock);
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -254,63 +267,113 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_take (lock);
+	intr_set_level (old_level);
 	return success;
 }
 
-/* Releases LOCK, which must be owned by the current thread.
-   This is lock_release function.
+/* Releases LOCK, which must be owned by the current thread, and
+   drops whatever priority its waiters donated.  The waiter that
+   gets LOCK runs at once if it ranks at least as high as the
+   current thread; see sema_up().
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
-	
-	//if(thread_current()->original_priority != thread_get_priority) thread_set_priority(thread_current()->original_priority);
-	
-	if(!thread_mlfqs){
-	struct list_elem *e;
-	thread_current()->priority = thread_current()->original_priority;
-	
-	for (e = list_begin (&thread_current()->donations); e != list_end (&thread_current()->donations); e = list_next (e)){
-		// if(list_entry(e,struct thread, d_elem)->wait_on_lock == lock){
-		// 	//list_remove(&e);
-		// 	list_remove(&list_entry(e,struct thread,d_elem)->d_elem);
-		// }
-		struct thread *temp = list_entry (e, struct thread, d_elem);
-		if (temp->wait_on_lock == lock)
-			list_remove (&temp->d_elem);
-	}
-    struct thread *cur = thread_current ();
-	cur->priority = cur->original_priority;
 
-	// donations 중 맥스값과 오리지널 값 비교후 최대값 설정
-	if(!list_empty(&cur->donations)){
-		struct thread* max_thread = list_entry(list_max(&cur->donations,compare_donation_priority,NULL),struct thread,d_elem);
-		cur->priority = MAX(cur->priority,max_thread->priority);
+	old_level = intr_disable ();
+	if (!thread_mlfqs) {
+		pq_remove (&lock->holder->held_locks, &lock->elem);
+		lock_update_donation (lock->holder);
 	}
+	lock->holder = NULL;
+	intr_set_level (old_level);
+
+	/* With interrupts back as the caller had them, so that
+	   sema_up() may hand the CPU to the waiter. */
+	sema_up (&lock->semaphore);
+}
+
+/* Recomputes T's effective priority as the greater of its own
+   priority and the priority donated through the locks it holds.
+   If that changes it and T is waiting for a lock, updates the
+   lock's place among its holder's locks and does the same for
+   the holder, and so on down the chain, stopping as soon as a
+   priority does not change.  Interrupts must be off. */
+void
+lock_update_donation (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (t != NULL) {
+		struct lock *lock = t->wait_on_lock;
+		int priority = t->original_priority;
+
+		if (!pq_empty (&t->held_locks))
+			priority = MAX (priority, pq_entry (pq_max (&t->held_locks),
+						struct lock, elem)->priority);
+		if (priority == t->priority)
+			return;
+
+		/* This also moves T among LOCK's waiters. */
+		thread_set_effective_priority (t, priority);
+		if (lock == NULL || lock->holder == NULL)
+			return;
+
+		priority = lock_top_priority (lock);
+		if (priority == lock->priority)
+			return;
+		lock->priority = priority;
+		pq_update (&lock->holder->held_locks, &lock->elem);
+		t = lock->holder;
 	}
+}
 
-	// if (!list_empty (&cur->donations)) {
-	// 	list_sort (&cur->donations, compare_donation_priority,NULL);
+/* Orders the locks a thread holds by the priority they donate. */
+bool
+lock_priority_less (const struct pq_elem *a, const struct pq_elem *b,
+		void *aux UNUSED) {
+	return pq_entry (a, struct lock, elem)->priority
+		< pq_entry (b, struct lock, elem)->priority;
+}
 
-    // 	struct thread *front = list_entry (list_front (&cur->donations), struct thread, d_elem);
-	// 	if (front->priority > cur->priority)
-	// 		cur->priority = front->priority;
-    // }
+/* Makes the current thread the holder of LOCK, which it has just
+   downed, and takes on the priority of LOCK's remaining
+   waiters.  Interrupts must be off. */
+static void
+lock_take (struct lock *lock) {
+	struct thread *cur = thread_current ();
 
-	lock->holder = NULL;
-	sema_up (&lock->semaphore);
+	lock->holder = cur;
+	if (!thread_mlfqs) {
+		lock->priority = lock_top_priority (lock);
+		pq_push (&cur->held_locks, &lock->elem);
+		lock_update_donation (cur);
+	}
+}
+
+/* Returns the priority of LOCK's highest-priority waiter, or
+   PRI_MIN if it has none. */
+static int
+lock_top_priority (const struct lock *lock) {
+	if (pq_empty (&lock->semaphore.waiters))
+		return PRI_MIN;
+	return pq_entry (pq_max (&lock->semaphore.waiters),
+			struct thread, wait_elem)->priority;
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -336,7 +399,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	pq_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -362,6 +425,7 @@ cond_init (struct condition *cond) {
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -369,9 +433,18 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters,&waiter.elem,cmp_sema_priority,NULL);
-	// if(thread_current() != (struct thread *)list_begin(&cond->waiters)) thread_yield();
+	waiter.thread = thread_current ();
+
+	/* Our priority orders us among COND's waiters until we are
+	   signaled, even once we block on WAITER.semaphore. */
+	old_level = intr_disable ();
+	if (thread_mlfqs)
+		thread_mlfqs_update (waiter.thread);
+	pq_push (&cond->waiters, &waiter.elem);
+	waiter.thread->wait_queue = &cond->waiters;
+	waiter.thread->wait_key = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -391,23 +464,30 @@ cond_signal (struct condition *cond, struct lock *lock) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	struct list_elem* e;
-	
-	// for (e = list_begin (&cond->waiters); e != list_end (&cond->waiters); e = list_next (e)){
-
-	// 	printf("%s:%d   ",list_entry(list_begin(&(list_entry(e,struct semaphore_elem,elem)->semaphore.waiters)),struct thread,elem)->name,list_entry(e,struct thread,elem)->priority);
-	
-	// }
-	// printf("\n");
-	// printf("cur thread: %s\n",thread_current()->name);
-	if (!list_empty (&cond->waiters)){
-		list_sort(&cond->waiters,cmp_sema_priority,NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level;
+
+	/* Waiters' priorities change under donation with interrupts
+	   off, not under LOCK, so COND's waiters need the same. */
+	old_level = intr_disable ();
+	if (!pq_empty (&cond->waiters)) {
+		waiter = pq_entry (pq_pop (&cond->waiters),
+				struct semaphore_elem, elem);
+		waiter->thread->wait_queue = NULL;
 	}
-	// if ( thread_current() == list_begin(&lock->semaphore.waiters)){
-	// 	return; //thread_yield();
-	// } else thread_yield();
+	intr_set_level (old_level);
+
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
+}
+
+/* Orders the waiters of a condition variable by the priorities
+   of their threads. */
+static bool
+cond_waiter_less (const struct pq_elem *a, const struct pq_elem *b,
+		void *aux UNUSED) {
+	return pq_entry (a, struct semaphore_elem, elem)->thread->priority
+		< pq_entry (b, struct semaphore_elem, elem)->thread->priority;
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -421,6 +501,81 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!pq_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
+
+/* Initializes LOCK, which is not held. */
+void
+spin_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+	lock->cpu = NULL;
+}
+
+/* Acquires LOCK, spinning until it is free, and turns interrupts
+   off until this CPU has released every spinlock it holds.  LOCK
+   must not already be held by this CPU.
+
+   This function never sleeps, so it may be called within an
+   interrupt handler. */
+void
+spin_lock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	spin_push_off ();
+	ASSERT (!spin_held_by_current_cpu (lock));
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (lock->locked)
+			asm volatile ("pause");
+	lock->cpu = cpu_current ();
+}
+
+/* Releases LOCK, which must be held by this CPU.  Releasing the
+   last spinlock this CPU holds restores the interrupt level from
+   before the first was acquired. */
+void
+spin_unlock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (spin_held_by_current_cpu (lock));
+
+	lock->cpu = NULL;
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+	spin_pop_off ();
+}
+
+/* Returns true if this CPU holds LOCK, false otherwise.
+   (Note that testing whether some other CPU holds a lock would
+   be racy.) */
+bool
+spin_held_by_current_cpu (const struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	return lock->locked && lock->cpu == cpu_current ();
+}
+
+/* Turns interrupts off for a spinlock about to be acquired.  The
+   interrupt level is saved only by the outermost of nested
+   calls, in this CPU's struct cpu, and restored by the matching
+   outermost spin_pop_off(). */
+static void
+spin_push_off (void) {
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = cpu_current ();
+
+	if (c->spin_depth++ == 0)
+		c->spin_level = old_level;
+}
+
+/* Undoes one spin_push_off(). */
+static void
+spin_pop_off (void) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (c->spin_depth > 0);
+
+	if (--c->spin_depth == 0)
+		intr_set_level (c->spin_level);
+}
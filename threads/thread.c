@@ -1,15 +1,22 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,13 +31,39 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-
-/* List of blocked threads. when timer_sleep() called, the thread(currently running)
-   is pushed to the tail of this list. when wakeup() called, head of
-   this list will be popped and be pushed to ready_list. *
-/* Idle thread. */
+/* Sleep queue: a hierarchical timer wheel of threads blocked in
+   timer_sleep().  Level L has SLEEP_WHEEL_SLOTS slots, each
+   covering SLEEP_WHEEL_SLOTS^L ticks, so that inserting a sleeper
+   is O(1) and each sleeper is moved down at most
+   SLEEP_WHEEL_LEVELS - 1 times before it expires.  Bit S of
+   sleep_mask[L] is set iff sleep_wheel[L][S] is non-empty. */
+#define SLEEP_WHEEL_BITS 6
+#define SLEEP_WHEEL_SLOTS (1 << SLEEP_WHEEL_BITS)
+#define SLEEP_WHEEL_LEVELS 4
+static struct list sleep_wheel[SLEEP_WHEEL_LEVELS][SLEEP_WHEEL_SLOTS];
+static uint64_t sleep_mask[SLEEP_WHEEL_LEVELS];
+static int64_t sleep_now;       /* Last tick the wheel has processed. */
+static int64_t sleep_next;      /* Earliest tick the wheel has work. */
+
+/* MLFQS state.  load_avg and every thread's recent_cpu are
+   recomputed once a second, which starts a new "epoch".  Instead
+   of sweeping every thread at each epoch, the decay factor of the
+   last MLFQS_HISTORY epochs is kept in mlfqs_decay[], indexed by
+   epoch modulo MLFQS_HISTORY, and a thread's recent_cpu and
+   priority are only brought up to date when the thread is put on
+   the run queue, picked from it to run, or queried. */
+#define MLFQS_HISTORY 1024
+static int mlfqs_decay[MLFQS_HISTORY];
+static int64_t mlfqs_epoch;     /* Current epoch. */
+
+/* List of all threads.  At the start of each epoch a few threads
+   from its front are brought up to date and moved to its back,
+   so that no thread falls more than MLFQS_HISTORY epochs
+   behind.  That sweep is done by mlfqs_sweep_work, outside the
+   timer interrupt. */
+static struct list all_list;
+static size_t all_cnt;
+static struct work mlfqs_sweep_work;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -41,31 +74,132 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
+/* Pages of exited threads, linked through `elem', kept so that
+   creating a thread does not have to go to the page allocator
+   and zero a whole page.  Only the struct thread at the bottom
+   of a cached page is cleared for reuse; the stack above it is
+   left as it was, or poisoned in debug builds.  Accessed with
+   interrupts off. */
+#define THREAD_CACHE_MAX 32
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+size_t thread_cache_max = THREAD_CACHE_MAX;
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+
+/* The threads that used the most CPU time, for
+   thread_print_stats(). */
+#define RU_TOP_CNT 5
+struct ru_top {
+	tid_t tid;
+	char name[16];
+	struct rusage ru;
+};
+
+/* The exited threads that used the most CPU time, most first. */
+static struct ru_top ru_top[RU_TOP_CNT];
+static size_t ru_top_cnt;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Completely fair scheduler.  A thread's vruntime advances by the
+   time it runs, scaled by NICE_0_WEIGHT over the weight of its
+   nice value, and the ready thread with the least vruntime runs
+   next.  Every runnable thread gets to run once per CFS_LATENCY,
+   or once per CFS_MIN_GRANULARITY times the number of runnable
+   threads if that is longer, for a slice in proportion to its
+   weight.  Controlled by kernel command-line option "-o cfs". */
+bool thread_cfs;
+
+#define CFS_LATENCY (NSEC_PER_SEC / 25)         /* 40 ms. */
+#define CFS_MIN_GRANULARITY (NSEC_PER_SEC / TIMER_FREQ)
+#define CFS_WAKEUP_GRANULARITY (NSEC_PER_SEC / TIMER_FREQ)
+#define NICE_0_WEIGHT 1024
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Each step
+   is about 1.25 times the next, so that one thread that is one
+   nice level lower than another gets about 10% more of the CPU
+   than it, whatever their nice values.  (The same table as
+   Linux's, extended to nice 20.) */
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */  9548,  7620,  6100,  4904,  3906,
+	/*  -5 */  3121,  2501,  1991,  1586,  1277,
+	/*   0 */  1024,   820,   655,   526,   423,
+	/*   5 */   335,   272,   215,   172,   137,
+	/*  10 */   110,    87,    70,    56,    45,
+	/*  15 */    36,    29,    23,    18,    15,
+	/*  20 */    12,
+};
+
+/* Real-time scheduling.  SCHED_FIFO threads together may use at
+   most RT_RUNTIME of every RT_PERIOD of a CPU while other threads
+   are ready, and the bandwidth of all SCHED_DEADLINE reservations,
+   as a DL_BW_SHIFT-bit binary fraction, may add up to at most
+   DL_BW_LIMIT per CPU, so that neither class can starve the rest
+   of the system. */
+#define RT_PERIOD NSEC_PER_SEC
+#define RT_RUNTIME (NSEC_PER_SEC / 100 * 95)
+#define DL_BW_SHIFT 20
+#define DL_BW_LIMIT ((1ULL << DL_BW_SHIFT) / 100 * 95)
+static uint64_t dl_total_bw;    /* Bandwidth of all reservations. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
+static intr_handler_func reschedule_interrupt;
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
-bool comapare_priority(struct list_elem *element, struct list_elem *before,void * aux);
-
-struct list ready_list;
-struct list sleep_list; 
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static void rq_init (struct runqueue *);
+static void rq_push (struct runqueue *, struct thread *);
+static void rq_remove (struct runqueue *, struct thread *);
+static struct thread *rq_pop (struct runqueue *);
+static int rq_max_priority (const struct runqueue *);
+static void ready_push (struct thread *);
+static struct cpu *select_cpu (struct thread *);
+static int ready_max_priority (void);
+static struct thread *steal_thread (struct cpu *);
+static void sleep_insert (struct thread *);
+static void sleep_update_next (void);
+static void mlfqs_catch_up (struct thread *);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_new_epoch (void);
+static void mlfqs_sweep (struct work *);
+static struct thread *mlfqs_pop (struct runqueue *);
+static unsigned cfs_weight (const struct thread *);
+static bool cfs_less (const struct rb_node *, const struct rb_node *,
+		void *aux);
+static void cfs_charge (struct thread *, uint64_t delta);
+static uint64_t cfs_slice (const struct thread *, const struct runqueue *);
+static void thread_charge (struct thread *);
+static bool thread_should_preempt (struct thread *);
+static bool thread_ranks_at_least (const struct thread *,
+		const struct thread *);
+static enum sched_policy rq_top_policy (const struct runqueue *);
+static size_t rq_normal_cnt (const struct runqueue *);
+static bool rt_less (const struct pq_elem *, const struct pq_elem *,
+		void *aux);
+static bool dl_less (const struct rb_node *, const struct rb_node *,
+		void *aux);
+static bool dl_wakeup (struct thread *);
+static void dl_release (struct thread *);
+static hrtimer_func dl_replenish;
+static void ru_top_insert (struct ru_top *, size_t *cnt,
+		const struct thread *);
+static void thread_charge_kernel (void);
+
+struct list wait_list;
 
 int READY_THREADS;
 int LOAD_AVG;
@@ -83,7 +217,6 @@ int LOAD_AVG;
  * somewhere in the middle, this locates the curent thread. */
 #define running_thread() ((struct thread *) (pg_round_down (rrsp ())))
 
-bool compare_donation_priority (const struct list_elem *cur, const struct list_elem *before, void *aux);
 extern bool thread_mlfqs;
 // Global descriptor table for the thread_start.
 // Because the gdt will be setup after the thread_init, we should
@@ -118,21 +251,34 @@ thread_init (void) {
 
 	/* Init the global thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&sleep_list);
+	for (int i = 0; i < CPU_MAX; i++)
+		rq_init (&cpus[i].rq);
+	for (int i = 0; i < SLEEP_WHEEL_LEVELS; i++) {
+		for (int j = 0; j < SLEEP_WHEEL_SLOTS; j++)
+			list_init (&sleep_wheel[i][j]);
+		sleep_mask[i] = 0;
+	}
+	sleep_now = 0;
+	sleep_next = INT64_MAX;
 	list_init (&destruction_req);
+	list_init (&thread_cache);
+	work_init (&mlfqs_sweep_work, mlfqs_sweep, NULL);
 	list_init (&wait_list);
+	list_init (&all_list);
+	all_cnt = 0;
+	mlfqs_epoch = 0;
 	READY_THREADS = 0;
 	LOAD_AVG = 0;
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
+	initial_thread->cpu = &cpus[0];
 	initial_thread->status = THREAD_RUNNING;
+	cpus[0].curr = initial_thread;
 	/* initialize the sleep queue date structure */
 	initial_thread->wakeup_tick = 0; // ? 
 	
-	initial_thread->exit_status = 0;
 	initial_thread->tid = allocate_tid ();
 
 }
@@ -145,6 +291,9 @@ thread_start (void) {
 	struct semaphore idle_started;
 	sema_init (&idle_started, 0);
 	thread_create ("idle", PRI_MIN, idle, &idle_started);
+	if (apic_enabled)
+		intr_register_ipi (CPU_RESCHEDULE_VEC, reschedule_interrupt,
+				"Reschedule");
 
 	/* Start preemptive thread scheduling. */
 	intr_enable ();
@@ -153,32 +302,180 @@ thread_start (void) {
 	sema_down (&idle_started);
 }
 
+/* Creates the idle thread of C, an application processor about
+   to be started.  The thread starts out as C's running thread:
+   the processor starts up on the thread's stack and ends up in
+   thread_start_ap().  Returns a null pointer if memory is
+   exhausted. */
+struct thread *
+thread_create_idle (struct cpu *c) {
+	struct thread *t = thread_page_get ();
+
+	if (t == NULL)
+		return NULL;
+	init_thread (t, "idle", PRI_MIN);
+	t->tid = allocate_tid ();
+	t->cpu = c;
+	t->status = THREAD_RUNNING;
+	c->idle_thread = t;
+	c->curr = t;
+	return t;
+}
+
+/* Starts scheduling on an application processor, at the end of
+   its startup, with interrupts off.  The running thread, the
+   one thread_create_idle() made, becomes its idle thread. */
+void
+thread_start_ap (void) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (thread_current () == c->idle_thread);
+
+	c->online = true;
+	idle_loop ();
+}
+
+/* Reschedule interrupt handler.  Another CPU made a thread ready
+   on this one, which may have to preempt the running thread. */
+static void
+reschedule_interrupt (struct intr_frame *f UNUSED) {
+	if (thread_should_preempt (thread_current ()))
+		intr_yield_on_return ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) {
 	struct thread *t = thread_current ();
+	struct cpu *c = t->cpu;
 
 	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	if (t == c->idle_thread)
+		c->idle_ticks++;
 #ifdef USERPROG
-	else if (t->pml4 != NULL)
-		user_ticks++;
+	else if (t->proc != NULL && t->proc->pml4 != NULL)
+		c->user_ticks++;
 #endif
 	else
-		kernel_ticks++;
+		c->kernel_ticks++;
+
+	/* Charge the running thread, and start a new SCHED_FIFO
+	   bandwidth window if the current one is over. */
+	thread_charge (t);
+	if (c->rt_time != 0 && timer_now_ns () >= c->rt_window_end) {
+		c->rt_time = 0;
+		spin_lock (&c->rq.lock);
+		c->rq.rt_throttled = false;
+		spin_unlock (&c->rq.lock);
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	c->thread_ticks++;
+	if (thread_should_preempt (t))
+		intr_yield_on_return ();
+	else if (t->policy == SCHED_NORMAL && !thread_cfs
+			&& c->thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
+/* Accounts CNT timer ticks that went by without a timer
+   interrupt while the idle thread was running in tickless mode.
+   Called from the timer interrupt handler. */
+void
+thread_tick_idle (int64_t cnt) {
+	ASSERT (cnt >= 0);
+	cpu_current ()->idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+	struct ru_top top[RU_TOP_CNT];
+	size_t top_cnt = ru_top_cnt;
+	enum intr_level old_level;
+	struct list_elem *e;
+	size_t i;
+
+	for (i = 0; i < cpu_cnt; i++) {
+		idle_ticks += cpus[i].idle_ticks;
+		kernel_ticks += cpus[i].kernel_ticks;
+		user_ticks += cpus[i].user_ticks;
+	}
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+
+	/* The threads still alive compete with those that exited. */
+	old_level = intr_disable ();
+	thread_charge_kernel ();
+	memcpy (top, ru_top, sizeof top);
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, allelem);
+		if (t != t->cpu->idle_thread)
+			ru_top_insert (top, &top_cnt, t);
+	}
+	intr_set_level (old_level);
+
+	for (i = 0; i < top_cnt; i++) {
+		const struct rusage *ru = &top[i].ru;
+		printf ("Thread: %s (tid %d): %"PRIu64" ms user, %"PRIu64" ms system, "
+				"%"PRIu64"+%"PRIu64" switches, %"PRIu64" faults, "
+				"%"PRIu64"/%"PRIu64" sectors read/written\n",
+				top[i].name, top[i].tid,
+				ru->utime / 1000000, ru->stime / 1000000,
+				ru->nvcsw, ru->nivcsw, ru->faults, ru->inblock, ru->oublock);
+	}
+}
+
+/* Called on entry to the kernel from user mode, by a system call
+   or an interrupt: charges the running thread for the time it
+   spent in user mode since it last left the kernel. */
+void
+thread_enter_kernel (void) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	uint64_t now = timer_now_ns ();
+
+	t->ru.utime += now - t->ru_stamp;
+	t->ru_stamp = now;
+	intr_set_level (old_level);
+}
+
+/* Called on return from the kernel to user mode: charges the
+   running thread for the time it spent in the kernel since it
+   last entered it or was switched to. */
+void
+thread_leave_kernel (void) {
+	enum intr_level old_level = intr_disable ();
+
+	thread_charge_kernel ();
+	intr_set_level (old_level);
+}
+
+/* Stores into RU the resources used so far by the running
+   thread. */
+void
+thread_get_rusage (struct rusage *ru) {
+	enum intr_level old_level = intr_disable ();
+
+	thread_charge_kernel ();
+	*ru = thread_current ()->ru;
+	intr_set_level (old_level);
+}
+
+/* Adds the usage in B to A. */
+void
+rusage_add (struct rusage *a, const struct rusage *b) {
+	a->utime += b->utime;
+	a->stime += b->stime;
+	a->nvcsw += b->nvcsw;
+	a->nivcsw += b->nivcsw;
+	a->faults += b->faults;
+	a->inblock += b->inblock;
+	a->oublock += b->oublock;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -199,36 +496,48 @@ thread_print_stats (void) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	return thread_create_in (NULL, name, priority, function, aux);
+}
+
+/* Like thread_create(), but the new thread belongs to process
+   PROC, or to none if PROC is null, from the start. */
+tid_t
+thread_create_in (struct process *proc, const char *name, int priority,
+		thread_func *function, void *aux) {
+	struct switch_threads_frame *frame;
 	struct thread *t;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
+	t->cpu = cpu_current ();
+	t->proc = proc;
 	tid = t->tid = allocate_tid ();
-	
-	if (t->name != 'idle'){
-		struct thread* cur = thread_current();
-		t->parent = cur;
-		list_push_back(&cur->child_list,&t->c_elem); //부모의 자식리스트에 현재 스레드를 저장
-		//printf("create..parent: %d, child:%d, list_head : %d\n\n",cur->tid, t->tid,list_entry(list_front(&cur->child_list),struct thread,c_elem)->tid);
-	}
-
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+
+	/* Under CFS, a new thread starts one slice's worth of
+	   vruntime behind the run queue, so that forking cannot be
+	   used to get more than a fair share of the CPU. */
+	if (thread_cfs) {
+		struct runqueue *rq = &t->cpu->rq;
+		t->vruntime = rq->min_vruntime
+			+ cfs_slice (t, rq) * NICE_0_WEIGHT / cfs_weight (t);
+	}
+
+	/* Stack frame for switch_threads(), which makes the first
+	 * switch to T "return" to switch_entry(), which in turn calls
+	 * kernel_thread (FUNCTION, AUX). */
+	frame = (struct switch_threads_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	frame->r12 = (uint64_t) kernel_thread;
+	frame->r13 = (uint64_t) function;
+	frame->r14 = (uint64_t) aux;
+	frame->rip = switch_entry;
+	t->stack = (uint8_t *) frame;
 
 	// printf("%d\n\n",aux);
 	// if(aux) t->parent = (struct thread *)aux; // 부모를 저장
@@ -238,11 +547,8 @@ thread_create (const char *name, int priority,
 	// if(t->parent) list_push_back(&t->parent->child_list,&t->c_elem); //부모의 자식리스트에 현재 스레드를 저장
   
 	/* Add to run queue. */
-	thread_unblock (t); // sorted by priority
+	thread_unblock (t);
 	// if newly created thread priority is bigger than current thread, yield.
-	struct list_elem *temp = list_begin(&ready_list);
-	struct thread *head_thread = list_entry (temp, struct thread, elem);
-
 	thread_test_preemption();
 	return tid;
 }
@@ -257,6 +563,7 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
+	thread_charge (thread_current ());
 	thread_current ()->status = THREAD_BLOCKED;
 	schedule ();
 }
@@ -269,15 +576,6 @@ thread_block (void) {
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
    update other data. */
-bool
-comapare_priority(struct list_elem *element, struct list_elem *before,void * aux){
-
-	struct thread * elem_thread = list_entry (element, struct thread, elem);
-	struct thread * before_thread = list_entry(before, struct thread, elem);
-	if( elem_thread->priority > before_thread->priority) return true;
-	
-	return false;
-}
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
@@ -286,10 +584,27 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	//list_push_back (&ready_list, &t->elem);
-	//list_sort(&ready_list,comapare_priority,NULL);
-	list_insert_ordered(&ready_list,&t->elem,comapare_priority,NULL);
+	if (t->policy == SCHED_DEADLINE && !dl_wakeup (t)) {
+		/* Out of budget: dl_replenish() will unblock T. */
+		intr_set_level (old_level);
+		return;
+	}
+	t->cpu = select_cpu (t);
+	if (thread_mlfqs) {
+		mlfqs_catch_up (t);
+		t->priority = mlfqs_priority (t);
+	} else if (thread_cfs && t->policy == SCHED_NORMAL) {
+		/* A thread that slept keeps up to half a latency period of
+		   credit, but no more, so that it runs soon without being
+		   able to monopolize the CPU after a long sleep. */
+		int64_t floor = t->cpu->rq.min_vruntime - CFS_LATENCY / 2;
+		if (t->vruntime < floor)
+			t->vruntime = floor;
+	}
+	ready_push (t);
 	t->status = THREAD_READY;
+	if (t->cpu != cpu_current ())
+		cpu_kick (t->cpu);
 	intr_set_level (old_level);
 }
 
@@ -332,12 +647,16 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	fpu_release (thread_current ());
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
-	// 추가해야 하는 것 아래에 있음!
-	//list_remove(&thread_current() -> allelem);
+	dl_release (thread_current ());
+	thread_charge_kernel ();
+	ru_top_insert (ru_top, &ru_top_cnt, thread_current ());
+	list_remove (&thread_current ()->allelem);
+	all_cnt--;
 	//thread_current()->status = THREAD_DYING;
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
@@ -352,57 +671,154 @@ thread_yield (void) {
 
 	ASSERT (!intr_context ()); 
 
+	/* Not in an RCU read-side critical section. */
+	if (curr->rcu_nesting > 0) {
+		curr->rcu_yield = true;
+		return;
+	}
+
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		list_insert_ordered(&ready_list,&curr->elem,comapare_priority,NULL);
-		//list_push_back (&ready_list, &curr->elem);
+	if (curr != curr->cpu->idle_thread) {
+		thread_charge (curr);
+		if (curr->policy == SCHED_DEADLINE && curr->dl.throttled) {
+			/* Out of budget: sleep until dl_replenish(). */
+			hrtimer_start (&curr->dl.timer,
+					curr->dl.period_start + curr->dl.period);
+			do_schedule (THREAD_BLOCKED);
+			intr_set_level (old_level);
+			return;
+		}
+		ready_push (curr);
+	}
 	
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level); // set a state of interrupt to the state passed to parameter and return previous interrupt state.
 }
 
-void thread_test_preemption (void){
-   if (!list_empty(&ready_list) && !intr_context() && thread_current ()->priority < list_entry(list_front(&ready_list), struct thread, elem)->priority){
+/* Hands the CPU directly to T, a thread just made ready on this
+   CPU, if T ranks at least as high as the running thread, which
+   becomes ready in turn.  T skips ahead of any other ready
+   threads and runs out the rest of the running thread's time
+   slice rather than starting a new one, so that a thread waking
+   up the thread it waits for, and vice versa, cannot keep the
+   CPU away from others by trading it back and forth.  Returns
+   true if T ran, false without yielding otherwise.
+
+   Unlike thread_yield(), this may not be called from an
+   interrupt handler. */
+bool
+thread_yield_to (struct thread *t) {
+	struct thread *curr = thread_current ();
+	struct cpu *c = curr->cpu;
+	enum intr_level old_level;
+	bool handoff = false;
+
+	ASSERT (!intr_context ());
+	ASSERT (is_thread (t));
+
+	old_level = intr_disable ();
+	if (curr == c->idle_thread || t == curr || curr->rcu_nesting > 0)
+		goto done;
+	thread_charge (curr);
+	if (curr->policy == SCHED_DEADLINE && curr->dl.throttled)
+		goto done;
+
+	spin_lock (&c->rq.lock);
+	if (t->status == THREAD_READY && t->cpu == c
+			&& thread_ranks_at_least (t, curr)) {
+		rq_remove (&c->rq, t);
+		rq_push (&c->rq, curr);
+		c->handoff = t;
+		handoff = true;
+	}
+	spin_unlock (&c->rq.lock);
+	if (handoff)
+		do_schedule (THREAD_READY);
+
+done:
+	intr_set_level (old_level);
+	return handoff;
+}
+
+/* Yields the CPU if a ready thread should preempt the running
+   one; see thread_should_preempt().  In an interrupt handler,
+   yields on return from the interrupt instead. */
+void
+thread_test_preemption (void) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+	bool preempt;
+
+	old_level = intr_disable ();
+	thread_charge (cur);
+	preempt = thread_should_preempt (cur);
+	intr_set_level (old_level);
+
+	if (!preempt)
+		return;
+	if (intr_context ())
+		intr_yield_on_return ();
+	else
 		thread_yield ();
+}
+
+/* Sets the effective priority of T to PRIORITY.  If T is on the
+   run queue it is moved to the queue for its new priority, and
+   if it is waiting in a priority queue keyed by its priority it
+   is moved within that queue, so priority donation and the MLFQS
+   recomputation can change the priority of a ready or waiting
+   thread without breaking either. */
+void
+thread_set_effective_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && t->priority != priority) {
+		struct runqueue *rq = &t->cpu->rq;
+
+		spin_lock (&rq->lock);
+		rq_remove (rq, t);
+		t->priority = priority;
+		rq_push (rq, t);
+		spin_unlock (&rq->lock);
+	} else if (t->priority != priority) {
+		t->priority = priority;
+		if (t->wait_queue != NULL)
+			pq_update (t->wait_queue, t->wait_key);
 	}
+	intr_set_level (old_level);
+}
+
+/* Returns the number of threads in the run queues of all
+   CPUs. */
+size_t
+thread_ready_count (void) {
+	size_t cnt = 0;
+
+	for (unsigned i = 0; i < cpu_cnt; i++)
+		cnt += cpus[i].rq.cnt;
+	return cnt;
 }
 
+/* Sets the current thread's priority to NEW_PRIORITY.  Priority
+   donated to it through the locks it holds still applies. */
 void
 thread_set_priority (int new_priority) {
 	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
 	cur->original_priority = new_priority;
-	cur->priority = cur->original_priority;
-
-	if(!thread_mlfqs){ // mlfqs 테스트가 아니어야만 도네이션 적용
-	if (!list_empty (&cur->donations)) {
-		list_sort (&cur->donations, compare_donation_priority,NULL);
-
-    	struct thread *front = list_entry (list_front (&cur->donations), struct thread, d_elem);
-		if (front->priority > cur->priority)
-			cur->priority = front->priority;
-    } 
-	}
-	// if (thread_current()->wait_on_lock){ // 내가 donation한 스레드가 존재한다면, 
-	// 	struct thread *donated_thread = thread_current()->wait_on_lock->holder;
-	// 	struct thread * max_thread = list_entry(list_max(&thread_current()->donations,compare_donation_priority,NULL),struct thread, d_elem);
-	// 	donated_thread->priority = max_thread->priority;
-	// }
-
-	struct list_elem *t = list_begin(&ready_list);
-	struct thread * cur_thread;
-	cur_thread = list_entry (t, struct thread, elem);
-	// if(cur_thread->priority > new_priority){
-	// 	//list_sort(ready_list)
-	// 	thread_yield(); //preemptive!
-	// } 
-	// thread_test_preemption();
-	
-	if (!list_empty (&ready_list)) {
-		struct thread *next = list_entry(list_begin(&ready_list), struct thread, elem);
-		if (next != NULL && next->priority > new_priority) {
-			thread_yield();
-		}
-  	}
+	if (thread_mlfqs)
+		thread_set_effective_priority (cur, new_priority);
+	else
+		lock_update_donation (cur);
+	intr_set_level (old_level);
+
+	thread_test_preemption ();
 }
 
 /* Returns the current thread's priority. */
@@ -411,11 +827,141 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
+/* Makes the current thread a SCHED_FIFO thread with the given
+   RT_PRIORITY.  It then runs before every SCHED_NORMAL thread and
+   every SCHED_FIFO thread of lower RT_PRIORITY, until it blocks,
+   yields or is preempted by a more urgent real-time thread.
+   Returns false, without changing anything, if RT_PRIORITY is not
+   between RT_PRI_MIN and RT_PRI_MAX. */
+bool
+thread_set_fifo (int rt_priority) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	if (rt_priority < RT_PRI_MIN || rt_priority > RT_PRI_MAX)
+		return false;
+
+	old_level = intr_disable ();
+	thread_charge (cur);
+	dl_release (cur);
+	cur->policy = SCHED_FIFO;
+	cur->rt_priority = rt_priority;
+	cur->exec_start = timer_now_ns ();
+	intr_set_level (old_level);
+
+	thread_test_preemption ();
+	return true;
+}
+
+/* Makes the current thread a SCHED_DEADLINE thread that may run
+   for RUNTIME ns in every PERIOD ns, each time finishing within
+   DEADLINE ns of the start of the period, all of which must be
+   positive with RUNTIME <= DEADLINE <= PERIOD.  Ready
+   SCHED_DEADLINE threads run before all others, earliest deadline
+   first.  A thread that uses up its budget is not run again until
+   its next period starts.
+
+   Returns false, without changing anything, if the arguments are
+   invalid or if admitting the reservation would take the
+   reservations' total bandwidth past what the CPUs can
+   guarantee. */
+bool
+thread_set_deadline (uint64_t runtime, uint64_t deadline, uint64_t period) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+	uint64_t bw, old_bw, now;
+
+	if (runtime == 0 || runtime > deadline || deadline > period
+			|| period > UINT64_MAX >> DL_BW_SHIFT)
+		return false;
+	bw = (runtime << DL_BW_SHIFT) / period;
+	if (bw == 0)
+		bw = 1;
+
+	old_level = intr_disable ();
+	old_bw = cur->policy == SCHED_DEADLINE ? cur->dl.bw : 0;
+	if (dl_total_bw - old_bw + bw > DL_BW_LIMIT * cpu_cnt) {
+		intr_set_level (old_level);
+		return false;
+	}
+	thread_charge (cur);
+	dl_total_bw = dl_total_bw - old_bw + bw;
+
+	now = timer_now_ns ();
+	cur->policy = SCHED_DEADLINE;
+	cur->dl.runtime = runtime;
+	cur->dl.deadline = deadline;
+	cur->dl.period = period;
+	cur->dl.bw = bw;
+	cur->dl.period_start = now;
+	cur->dl.abs_deadline = now + deadline;
+	cur->dl.left = runtime;
+	cur->dl.throttled = false;
+	cur->exec_start = now;
+	intr_set_level (old_level);
+
+	thread_test_preemption ();
+	return true;
+}
+
+/* Returns the current thread to the SCHED_NORMAL class, giving
+   up any SCHED_DEADLINE reservation it had. */
+void
+thread_set_normal (void) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	thread_charge (cur);
+	dl_release (cur);
+	cur->policy = SCHED_NORMAL;
+	cur->exec_start = timer_now_ns ();
+	if (cur->vruntime < cur->cpu->rq.min_vruntime)
+		cur->vruntime = cur->cpu->rq.min_vruntime;
+	intr_set_level (old_level);
+
+	thread_test_preemption ();
+}
+
+/* Returns the current thread's scheduling class. */
+enum sched_policy
+thread_get_policy (void) {
+	return thread_current ()->policy;
+}
+
+/* For a SCHED_DEADLINE thread, gives up the rest of the current
+   period's budget, marking the end of the current job, and sleeps
+   until the next period starts.  Other threads just yield. */
+void
+thread_yield_period (void) {
+	struct thread *cur = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (cur->policy == SCHED_DEADLINE) {
+		thread_charge (cur);
+		if (cur->dl.left > 0)
+			cur->dl.left = 0;
+		cur->dl.throttled = true;
+	}
+	thread_yield ();
+	intr_set_level (old_level);
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int nice UNUSED) {
 	/* TODO: Your implementation goes here */
-	thread_current()->nice = nice;
+	struct thread *cur = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	/* Charge the time run so far at the old weight. */
+	thread_charge (cur);
+	cur->nice = nice;
+	if (thread_mlfqs)
+		thread_set_effective_priority (cur, mlfqs_priority (cur));
+	intr_set_level (old_level);
+	thread_test_preemption ();
 }
  
 /* Returns the current thread's nice value. */
@@ -443,23 +989,57 @@ thread_get_recent_cpu (void) {
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
+   point it registers itself as its CPU's idle thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
    ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   special case when the ready list is empty.
+
+   The application processors' idle threads are made by
+   thread_create_idle() instead, and go straight to idle_loop(). */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	cpu_current ()->idle_thread = thread_current ();
 	sema_up (idle_started);
+	idle_loop ();
+}
+
+/* Body of every CPU's idle thread. */
+static void
+idle_loop (void) {
+	struct thread *self = thread_current ();
 
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
+		/* Put the idle time to use zeroing pages ahead of PAL_ZERO
+		   allocations, a page at a time, with interrupts on so that
+		   a thread woken meanwhile can preempt us.  The pools have
+		   locks of their own, so we drop the big kernel lock around
+		   each page rather than keep the other CPUs out of the
+		   kernel for the whole refill. */
+		while (!thread_should_preempt (self)) {
+			bool zeroed;
+
+			kernel_unlock ();
+			intr_enable ();
+			zeroed = palloc_zero_idle ();
+			intr_disable ();
+			kernel_lock ();
+			if (!zeroed)
+				break;
+		}
+		if (thread_should_preempt (self))
+			continue;
+
+		/* In tickless mode, stop the periodic timer until the next
+		   sleeper is due. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -471,8 +1051,15 @@ idle (void *idle_started_ UNUSED) {
 		   time.
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
+		   7.11.1 "HLT Instruction".
+
+		   The other CPUs may enter the kernel while we wait; the
+		   interrupt that wakes us takes the big kernel lock for its
+		   handler, and we take it back afterward. */
+		kernel_unlock ();
 		asm volatile ("sti; hlt" : : : "memory");
+		intr_disable ();
+		kernel_lock ();
 	}
 }
 
@@ -491,6 +1078,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -498,41 +1087,244 @@ init_thread (struct thread *t, const char *name, int priority) {
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->original_priority = priority;
 	t->wait_on_lock= NULL;
-	list_init(&t->donations);
+	pq_init (&t->held_locks, lock_priority_less, NULL);
+	hrtimer_init (&t->dl.timer, dl_replenish, t);
 	t->magic = THREAD_MAGIC;
 	t->nice = 0;
 	t->recent_cpu = 0;
-	t->waiting_child = 0;   
-	memset(t->p_name,0,sizeof(t->p_name));
-	list_init(&t->child_list);
-	sema_init(&t->wait_sema, 0);
-	sema_init(&t->fork_sema, 0);
-	sema_init(&t->exit_sema, 0);
-	list_init(&t->exit_child_list);
-	//list_init(&t->killed_list);
-	
+	old_level = intr_disable ();
+	t->mlfqs_epoch = mlfqs_epoch;
+	list_push_back (&all_list, &t->allelem);
+	all_cnt++;
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from this CPU's run queue, unless it is empty,
+   in which case a thread is stolen from another CPU.  (If the
+   running thread can continue running, then it will be in the
+   run queue.)  If no CPU has a ready thread, returns this CPU's
+   idle thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct cpu *c = cpu_current ();
+	struct runqueue *rq = &c->rq;
+	struct thread *next;
+
+	if (c->handoff != NULL)
+		return c->handoff;
+
+	spin_lock (&rq->lock);
+	next = thread_mlfqs ? mlfqs_pop (rq) : rq_pop (rq);
+	spin_unlock (&rq->lock);
+
+	if (next == NULL)
+		next = steal_thread (c);
+	return next != NULL ? next : c->idle_thread;
+}
+
+/* Takes the highest-priority ready thread from the busiest other
+   CPU's run queue, for C to run.  Returns a null pointer if no
+   other CPU has a ready thread. */
+static struct thread *
+steal_thread (struct cpu *c) {
+	struct cpu *victim = NULL;
+	struct thread *t = NULL;
+
+	/* Peeking at the counts without the locks is only a hint.  An
+	   idle CPU is about to run its own ready threads. */
+	for (unsigned i = 1; i < cpu_cnt; i++) {
+		struct cpu *other = &cpus[(c->id + i) % cpu_cnt];
+		if (other->rq.cnt > 0 && other->curr != other->idle_thread
+				&& (victim == NULL || other->rq.cnt > victim->rq.cnt))
+			victim = other;
+	}
+
+	if (victim != NULL) {
+		spin_lock (&victim->rq.lock);
+		t = thread_mlfqs ? mlfqs_pop (&victim->rq) : rq_pop (&victim->rq);
+		/* Only VICTIM can save the FPU registers of its FPU owner,
+		   so leave it there. */
+		if (t != NULL && victim->fpu_owner == t) {
+			rq_push (&victim->rq, t);
+			t = NULL;
+		}
+		spin_unlock (&victim->rq.lock);
+
+		/* Keep T's place relative to the other threads. */
+		if (t != NULL && thread_cfs && t->policy == SCHED_NORMAL)
+			t->vruntime += c->rq.min_vruntime - victim->rq.min_vruntime;
+	}
+	return t;
+}
+
+/* Returns the CPU that T, which is about to be made ready, should
+   be queued on: the running CPU, whose preemption check then sees
+   T.  Another CPU could not run T before this one leaves the
+   kernel anyway, since it would wait for the big kernel lock, so
+   T would wait behind whatever this CPU runs, whatever their
+   priorities.  Idle CPUs pick up the surplus by stealing.  A
+   thread whose FPU registers are still loaded on another CPU,
+   because it blocked before that CPU was started, stays there,
+   since only that CPU can save them. */
+static struct cpu *
+select_cpu (struct thread *t) {
+	struct cpu *c = cpu_current ();
+
+	if (t->cpu == c || t->cpu->fpu_owner == t)
+		return t->cpu;
+	/* Keep T's place relative to the other threads. */
+	if (thread_cfs && t->policy == SCHED_NORMAL)
+		t->vruntime += c->rq.min_vruntime - t->cpu->rq.min_vruntime;
+	return c;
+}
+
+/* Appends T to the run queue of the CPU it last ran on. */
+static void
+ready_push (struct thread *t) {
+	struct runqueue *rq = &t->cpu->rq;
+
+	spin_lock (&rq->lock);
+	rq_push (rq, t);
+	spin_unlock (&rq->lock);
+}
+
+/* Returns the highest priority among threads ready on this CPU,
+   or PRI_MIN - 1 if there are none. */
+static int
+ready_max_priority (void) {
+	return rq_max_priority (&cpu_current ()->rq);
+}
+
+/* Initializes RQ as an empty run queue. */
+static void
+rq_init (struct runqueue *rq) {
+	spin_init (&rq->lock);
+	for (int i = 0; i < PRI_MAX - PRI_MIN + 1; i++)
+		list_init (&rq->queues[i]);
+	rq->mask = 0;
+	rq->cnt = 0;
+	rb_init (&rq->cfs_tree, cfs_less, NULL);
+	rq->cfs_load = 0;
+	rq->min_vruntime = 0;
+	pq_init (&rq->rt_queue, rt_less, NULL);
+	rb_init (&rq->dl_tree, dl_less, NULL);
+	rq->rt_throttled = false;
+}
+
+/* Appends T to the queue for its priority in RQ, whose lock must
+   be held, or under CFS inserts it by vruntime.  Real-time
+   threads go to the queue for their class instead. */
+static void
+rq_push (struct runqueue *rq, struct thread *t) {
+	int level = t->priority - PRI_MIN;
+
+	rq->cnt++;
+	if (t->policy == SCHED_DEADLINE)
+		rb_insert (&rq->dl_tree, &t->rb_elem);
+	else if (t->policy == SCHED_FIFO)
+		pq_push (&rq->rt_queue, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_insert (&rq->cfs_tree, &t->rb_elem);
+		rq->cfs_load += cfs_weight (t);
+	} else {
+		list_push_back (&rq->queues[level], &t->elem);
+		rq->mask |= 1ULL << level;
+	}
+}
+
+/* Removes T from RQ, whose lock must be held. */
+static void
+rq_remove (struct runqueue *rq, struct thread *t) {
+	int level = t->priority - PRI_MIN;
+
+	rq->cnt--;
+	if (t->policy == SCHED_DEADLINE)
+		rb_remove (&rq->dl_tree, &t->rb_elem);
+	else if (t->policy == SCHED_FIFO)
+		pq_remove (&rq->rt_queue, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_remove (&rq->cfs_tree, &t->rb_elem);
+		rq->cfs_load -= cfs_weight (t);
+	} else {
+		list_remove (&t->elem);
+		if (list_empty (&rq->queues[level]))
+			rq->mask &= ~(1ULL << level);
+	}
 }
 
-/* Use iretq to launch the thread */
+/* Removes and returns the next thread to run from RQ, whose lock
+   must be held: the SCHED_DEADLINE thread with the earliest
+   deadline, else the SCHED_FIFO thread with the highest priority,
+   else the first thread of the highest non-empty queue, or under
+   CFS the thread with the least vruntime.  Returns a null pointer
+   if RQ is empty. */
+static struct thread *
+rq_pop (struct runqueue *rq) {
+	struct thread *t;
+
+	if (rq->cnt == 0)
+		return NULL;
+	switch (rq_top_policy (rq)) {
+	case SCHED_DEADLINE:
+		t = rb_entry (rb_min (&rq->dl_tree), struct thread, rb_elem);
+		break;
+	case SCHED_FIFO:
+		t = pq_entry (pq_max (&rq->rt_queue), struct thread, rt_elem);
+		break;
+	default:
+		if (thread_cfs)
+			t = rb_entry (rb_min (&rq->cfs_tree), struct thread, rb_elem);
+		else
+			t = list_entry (list_front (&rq->queues[rq_max_priority (rq) - PRI_MIN]),
+					struct thread, elem);
+		break;
+	}
+	rq_remove (rq, t);
+	return t;
+}
+
+/* Returns the class of the thread that rq_pop() would take from
+   RQ, whose lock must be held and which must not be empty.
+   SCHED_FIFO threads that used up their bandwidth are passed over
+   while there are SCHED_NORMAL threads to run instead. */
+static enum sched_policy
+rq_top_policy (const struct runqueue *rq) {
+	if (!rb_empty (&rq->dl_tree))
+		return SCHED_DEADLINE;
+	if (!pq_empty (&rq->rt_queue)
+			&& !(rq->rt_throttled && rq_normal_cnt (rq) > 0))
+		return SCHED_FIFO;
+	return SCHED_NORMAL;
+}
+
+/* Returns the number of SCHED_NORMAL threads in RQ. */
+static size_t
+rq_normal_cnt (const struct runqueue *rq) {
+	return rq->cnt - pq_size (&rq->rt_queue) - rb_size (&rq->dl_tree);
+}
+
+/* Returns the highest priority in RQ, or PRI_MIN - 1 if RQ is
+   empty. */
+static int
+rq_max_priority (const struct runqueue *rq) {
+	if (rq->mask == 0)
+		return PRI_MIN - 1;
+	return PRI_MIN + 63 - __builtin_clzll (rq->mask);
+}
+
+/* Loads the registers in TF and enters it with iretq.  Used for a
+   process's first entry into user mode, so it also releases the
+   big kernel lock and switches back to the user GS base, as the
+   exit from intr_entry does. */
 void
 do_iret (struct intr_frame *tf) {
+	thread_leave_kernel ();
+	intr_disable ();
+	kernel_unlock ();
 	__asm __volatile(
 			"movq %0, %%rsp\n"
 			"movq 0(%%rsp),%%r15\n"
@@ -554,77 +1346,26 @@ do_iret (struct intr_frame *tf) {
 			"movw 8(%%rsp),%%ds\n"
 			"movw (%%rsp),%%es\n"
 			"addq $32, %%rsp\n"
-			"iretq"
+			"testb $3, 8(%%rsp)\n"
+			"jz 1f\n"
+			"swapgs\n"
+			"1: iretq"
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
+/* Switches from the running thread to TH.  Both run in kernel
+   mode, so only the callee-saved registers and the stack pointer
+   need to be saved and restored; see switch.S.  A thread's first
+   entry into user mode goes through do_iret() instead.
 
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   At this function's invocation, the new thread's page tables
+   are already active and interrupts are still disabled.  It
+   returns once some other thread switches back to this one. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	switch_threads (&running_thread ()->stack, th->stack);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -635,39 +1376,48 @@ static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (thread_current()->status == THREAD_RUNNING);
+	ASSERT (thread_current ()->rcu_nesting == 0);
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_put (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
 }
 
-struct thread*
-next_thread_to_run_mlfqs(void){
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else{
-		list_sort(&ready_list,comapare_priority,NULL);
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
-	}
-}
-
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();
-	//struct thread *next = next_thread_to_run (); // mlfq에서는 다른 스케줄링 방식을 사용해야함!
-	struct thread *next = next_thread_to_run_mlfqs();
+	struct thread *next = next_thread_to_run ();
+	struct cpu *c = curr->cpu;
+	bool handoff = next == c->handoff;
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
+	next->cpu = c;
+	c->curr = next;
+	c->rcu_qs++;
+
+	/* Start new time slice, unless CURR handed NEXT the rest of
+	   its own. */
+	c->handoff = NULL;
+	if (!handoff)
+		c->thread_ticks = 0;
+	if (next != c->idle_thread) {
+		if (thread_cfs || next->policy != SCHED_NORMAL)
+			next->exec_start = timer_now_ns ();
+		if (thread_cfs && !handoff)
+			c->slice_end = next->exec_start + cfs_slice (next, &c->rq);
+	}
 
-	/* Start new time slice. */
-	thread_ticks = 0;
+	/* Leaving the idle thread: bring the timer back to a periodic
+	   tick if it was stopped. */
+	if (curr == c->idle_thread && next != c->idle_thread)
+		timer_idle_exit ();
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -675,6 +1425,21 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
+		/* A blocked thread is woken up on the waking CPU, which
+		   cannot reach the registers of this one. */
+		if (curr->status == THREAD_BLOCKED && cpu_cnt > 1)
+			fpu_unload (curr);
+		fpu_switch (next);
+
+		/* Charge CURR, counting the switch as voluntary if CURR is
+		   waiting for something. */
+		thread_charge_kernel ();
+		if (curr->status == THREAD_BLOCKED)
+			curr->ru.nvcsw++;
+		else if (curr->status == THREAD_READY)
+			curr->ru.nivcsw++;
+		next->ru_stamp = curr->ru_stamp;
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -707,38 +1472,627 @@ allocate_tid (void) {
 	return tid;
 }
 
+/* Returns a page for a new thread, from the thread cache if it
+   has one, or a null pointer if memory is exhausted.  The page is
+   not cleared; init_thread() clears its struct thread. */
+static struct thread *
+thread_page_get (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level (old_level);
+
+	return t != NULL ? t : palloc_get_page (0);
+}
+
+/* Puts the page of T, which has exited, in the thread cache, or
+   frees it if the cache is full.  Interrupts must be off. */
+static void
+thread_page_put (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt >= thread_cache_max) {
+		palloc_free_page (t);
+		return;
+	}
+#ifndef NDEBUG
+	memset ((uint8_t *) t + sizeof *t, 0xcc, PGSIZE - sizeof *t);
+#endif
+	list_push_front (&thread_cache, &t->elem);
+	thread_cache_cnt++;
+}
+
+/* Frees every page in the thread cache, for when the page
+   allocator runs out.  Returns the number of pages freed. */
+size_t
+thread_cache_shrink (void) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt = thread_cache_cnt;
+
+	while (!list_empty (&thread_cache))
+		palloc_free_page (list_entry (list_pop_front (&thread_cache),
+				struct thread, elem));
+	thread_cache_cnt = 0;
+	intr_set_level (old_level);
+	return cnt;
+}
 
-//// implements 
 
-void thread_sleep(int64_t ticks)
-{
+/* Puts the current thread to sleep until the timer reaches tick
+   TICKS.  Returns immediately if that tick has already passed. */
+void
+thread_sleep (int64_t ticks) {
 	struct thread *t = thread_current ();
 	enum intr_level old_level;
-	old_level = intr_disable ();
 
-	if (t != idle_thread){ // what should i do?
-		// update the global tick
+	ASSERT (!intr_context ());
+	ASSERT (t != t->cpu->idle_thread);
+
+	old_level = intr_disable ();
+	if (ticks > sleep_now) {
 		t->wakeup_tick = ticks;
-		list_insert_ordered(&sleep_list,&t->elem,comapare_priority,NULL);
-		thread_block();
+		sleep_insert (t);
+		sleep_update_next ();
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Wakes up every sleeping thread whose wakeup_tick is at most
+   TICKS.  Called by the timer interrupt handler on every tick;
+   does nothing but a comparison unless a sleeper is due or a
+   wheel slot has to be moved down a level. */
+void
+thread_wakeup (int64_t ticks) {
+	bool woken = false;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (sleep_next <= ticks) {
+		int64_t now = sleep_now = sleep_next;
+		struct list *slot;
+
+		/* Move the sleepers of every level that wrapped around at
+		   NOW down to the lower levels. */
+		for (int level = 1; level < SLEEP_WHEEL_LEVELS; level++) {
+			int shift = level * SLEEP_WHEEL_BITS;
+			int idx;
+
+			if ((now & ((1LL << shift) - 1)) != 0)
+				break;
+			idx = (now >> shift) & (SLEEP_WHEEL_SLOTS - 1);
+			slot = &sleep_wheel[level][idx];
+			sleep_mask[level] &= ~(1ULL << idx);
+			while (!list_empty (slot))
+				sleep_insert (list_entry (list_pop_front (slot),
+							struct thread, elem));
+		}
+
+		/* Wake up the threads that are due at NOW. */
+		slot = &sleep_wheel[0][now & (SLEEP_WHEEL_SLOTS - 1)];
+		sleep_mask[0] &= ~(1ULL << (now & (SLEEP_WHEEL_SLOTS - 1)));
+		while (!list_empty (slot)) {
+			struct thread *t = list_entry (list_pop_front (slot),
+					struct thread, elem);
+			ASSERT (t->wakeup_tick == now);
+			thread_unblock (t);
+			woken = true;
+		}
+
+		sleep_update_next ();
+	}
+	sleep_now = ticks;
+
+	/* A woken thread that should preempt the running one, such as
+	   a real-time thread, need not wait for the end of its
+	   slice. */
+	if (woken)
+		thread_test_preemption ();
+}
+
+/* Returns the earliest tick at which thread_wakeup() may have
+   work to do, or INT64_MAX if no thread is sleeping.  Must be
+   called with interrupts off. */
+int64_t
+thread_next_wakeup (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	return sleep_next;
+}
+
+/* Inserts T into the slot of the sleep wheel that covers its
+   wakeup_tick, relative to sleep_now.  A sleeper due at sleep_now
+   itself goes into the level-0 slot that thread_wakeup() is about
+   to expire.  Sleepers too far in the
+   future for the top level are parked in its last slot and
+   reinserted when that slot comes due. */
+static void
+sleep_insert (struct thread *t) {
+	int64_t when = t->wakeup_tick;
+	int64_t delta = when - sleep_now;
+	int level, idx;
+
+	ASSERT (delta >= 0);
+
+	for (level = 0; level < SLEEP_WHEEL_LEVELS - 1; level++)
+		if (delta < 1LL << ((level + 1) * SLEEP_WHEEL_BITS))
+			break;
+	if (delta >= 1LL << (SLEEP_WHEEL_LEVELS * SLEEP_WHEEL_BITS))
+		when = sleep_now + (1LL << (SLEEP_WHEEL_LEVELS * SLEEP_WHEEL_BITS)) - 1;
+
+	idx = (when >> (level * SLEEP_WHEEL_BITS)) & (SLEEP_WHEEL_SLOTS - 1);
+	list_push_back (&sleep_wheel[level][idx], &t->elem);
+	sleep_mask[level] |= 1ULL << idx;
+}
+
+/* Recomputes sleep_next, the earliest tick after sleep_now at
+   which a level-0 slot expires or a higher-level slot has to be
+   moved down, from the occupancy masks alone. */
+static void
+sleep_update_next (void) {
+	sleep_next = INT64_MAX;
+
+	for (int level = 0; level < SLEEP_WHEEL_LEVELS; level++) {
+		int shift = level * SLEEP_WHEEL_BITS;
+		int64_t block = sleep_now >> shift;
+		int cur = block & (SLEEP_WHEEL_SLOTS - 1);
+		uint64_t mask = sleep_mask[level];
+		int64_t when;
+		int dist;
+
+		if (mask == 0)
+			continue;
+
+		/* Distance, in slots, from the current slot to the next
+		   occupied one.  A full turn (64) means the current slot,
+		   which is only due once the wheel wraps around. */
+		mask = (mask >> ((cur + 1) % SLEEP_WHEEL_SLOTS))
+			| (mask << ((SLEEP_WHEEL_SLOTS - cur - 1) % SLEEP_WHEEL_SLOTS));
+		dist = __builtin_ctzll (mask) + 1;
+		when = (block + dist) << shift;
+		if (when < sleep_next)
+			sleep_next = when;
+	}
+}
+
+/* Called by the timer interrupt handler at each timer tick when
+   the MLFQS is in use.  Only the running thread is updated here;
+   everyone else catches up lazily, so the work done does not
+   depend on the number of threads.  TICKS counts the ticks of
+   this CPU's timer, and only the bootstrap processor's starts
+   new epochs. */
+void
+thread_mlfqs_tick (int64_t ticks) {
+	struct thread *cur = thread_current ();
+	bool idle = cur == cur->cpu->idle_thread;
+
+	ASSERT (intr_context ());
+
+	/* Another CPU may have started an epoch since CUR last caught
+	   up, and the tick belongs to the new one. */
+	if (!idle) {
+		mlfqs_catch_up (cur);
+		cur->recent_cpu = add_x_and_n (cur->recent_cpu, 1);
+	}
+
+	if (cur->cpu->id == 0 && ticks % TIMER_FREQ == 0)
+		mlfqs_new_epoch ();
+
+	if (ticks % 4 == 0 && !idle) {
+		thread_set_effective_priority (cur, mlfqs_priority (cur));
+		if (cur->policy == SCHED_NORMAL
+				&& cur->priority < ready_max_priority ())
+			intr_yield_on_return ();
+	}
+}
+
+/* Brings T's recent_cpu up to date with the current MLFQS epoch
+   and recomputes T's priority from it, moving T to its new run
+   queue if it is ready.  Must be called with interrupts off. */
+void
+thread_mlfqs_update (struct thread *t) {
+	ASSERT (thread_mlfqs);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	mlfqs_catch_up (t);
+	thread_set_effective_priority (t, mlfqs_priority (t));
+}
+
+/* Applies to T's recent_cpu the decay of every epoch since the
+   one it was last brought up to date at, in order, so that the
+   result is exactly what a sweep at every epoch would give. */
+static void
+mlfqs_catch_up (struct thread *t) {
+	ASSERT (mlfqs_epoch - t->mlfqs_epoch <= MLFQS_HISTORY);
+
+	while (t->mlfqs_epoch < mlfqs_epoch) {
+		t->mlfqs_epoch++;
+		t->recent_cpu = add_x_and_n (mul_x_by_y (
+				mlfqs_decay[t->mlfqs_epoch % MLFQS_HISTORY], t->recent_cpu),
+				t->nice);
+	}
+}
+
+/* Returns the MLFQS priority of T for its current recent_cpu and
+   nice, clamped to PRI_MIN...PRI_MAX. */
+static int
+mlfqs_priority (const struct thread *t) {
+	int priority = convert_x_to_int_round_to_nearest (sub_n_from_x (
+			sub_y_from_x (convert_n_to_fp (PRI_MAX), div_x_by_n (t->recent_cpu, 4)),
+			2 * t->nice));
+
+	if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	else if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	return priority;
+}
+
+/* Starts a new MLFQS epoch: updates load_avg and records the
+   epoch's recent_cpu decay factor.  The running thread and a few
+   threads from the front of all_list are brought up to date; a
+   ready thread is brought up to date when next_thread_to_run()
+   picks it, which we force to happen by yielding on return from
+   the interrupt. */
+static void
+mlfqs_new_epoch (void) {
+	struct thread *cur = thread_current ();
+
+	READY_THREADS = thread_ready_count ();
+	for (unsigned i = 0; i < cpu_cnt; i++)
+		if (cpus[i].curr != cpus[i].idle_thread)
+			READY_THREADS++;
+	LOAD_AVG = add_x_and_y (div_x_by_n (mul_x_by_n (LOAD_AVG, 59), 60),
+			div_x_by_n (convert_n_to_fp (READY_THREADS), 60));
+
+	mlfqs_epoch++;
+	mlfqs_decay[mlfqs_epoch % MLFQS_HISTORY] = div_x_by_y (mul_x_by_n (LOAD_AVG, 2),
+			add_x_and_n (mul_x_by_n (LOAD_AVG, 2), 1));
+
+	mlfqs_catch_up (cur);
+	queue_work (system_wq, &mlfqs_sweep_work);
+
+	if (cur->cpu->rq.cnt > 0)
+		intr_yield_on_return ();
+}
+
+/* Brings a few threads from the front of all_list up to date with
+   the current MLFQS epoch and moves them to its back.  Runs once
+   per epoch on the system workqueue. */
+static void
+mlfqs_sweep (struct work *work UNUSED) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt;
+
+	for (cnt = all_cnt / (MLFQS_HISTORY / 2) + 1; cnt > 0; cnt--) {
+		struct thread *t = list_entry (list_pop_front (&all_list),
+				struct thread, allelem);
+		list_push_back (&all_list, &t->allelem);
+		mlfqs_catch_up (t);
 	}
 	intr_set_level (old_level);
-	/* if the current thread is not idle thread, change the state of the caller thread to BLOCKED,
-	   store the local tick to wake up, update the global tick if necessary, and call schedule()
-	   when you manipulate thread list, disable interrupt! */
-}
-
-void thread_wakeup(int64_t ticks)
-{	
-	//struct list_elem *t = sleep_list.head.next;
-	struct list_elem *t = list_begin(&sleep_list);
-	struct thread * cur_thread;
-	while (t != list_end(&sleep_list)){
-		cur_thread = list_entry (t, struct thread, elem);
-		if ( cur_thread->wakeup_tick <= ticks){
-			t = list_remove(t);
-			thread_unblock(cur_thread);
+}
+
+/* Removes and returns the next thread to run from RQ, whose lock
+   must be held, like rq_pop(), but first brings the MLFQS priority
+   of a SCHED_NORMAL thread it would pick up to date.  A ready
+   thread is queued by its priority as of when it was queued, so
+   if that has since fallen below the best in RQ, the thread is
+   queued again by its new priority and the next one is tried.
+   A requeued thread is up to date, so each thread is requeued at
+   most once per epoch.  No thread is left waiting forever on a
+   stale priority either, because the priority of whatever runs
+   instead falls as it uses the CPU. */
+static struct thread *
+mlfqs_pop (struct runqueue *rq) {
+	struct thread *t;
+
+	while ((t = rq_pop (rq)) != NULL && t->policy == SCHED_NORMAL) {
+		int priority;
+
+		mlfqs_catch_up (t);
+		priority = mlfqs_priority (t);
+		if (priority == t->priority || priority >= rq_max_priority (rq)) {
+			t->priority = priority;
+			break;
+		}
+		t->priority = priority;
+		rq_push (rq, t);
+	}
+	return t;
+}
+
+/* Returns the CFS weight of T's nice value. */
+static unsigned
+cfs_weight (const struct thread *t) {
+	int nice = t->nice;
+
+	if (nice < NICE_MIN)
+		nice = NICE_MIN;
+	else if (nice > NICE_MAX)
+		nice = NICE_MAX;
+	return cfs_weights[nice - NICE_MIN];
+}
+
+/* Orders threads in a CFS run queue by vruntime. */
+static bool
+cfs_less (const struct rb_node *a_, const struct rb_node *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, rb_elem);
+	const struct thread *b = rb_entry (b_, struct thread, rb_elem);
+
+	return a->vruntime < b->vruntime;
+}
+
+/* Charges T, the running thread, for the time it has run since
+   it was last charged: SCHED_DEADLINE threads against their
+   budget, which throttles them when it runs out; SCHED_FIFO
+   threads against their CPU's real-time bandwidth; and under CFS
+   other threads in vruntime.  Must be called with interrupts
+   off. */
+static void
+thread_charge (struct thread *t) {
+	struct cpu *c = t->cpu;
+	uint64_t now, delta;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t == c->idle_thread || (t->policy == SCHED_NORMAL && !thread_cfs))
+		return;
+	now = timer_now_ns ();
+	delta = now > t->exec_start ? now - t->exec_start : 0;
+	t->exec_start = now;
+
+	switch (t->policy) {
+	case SCHED_DEADLINE:
+		t->dl.left -= delta;
+		if (t->dl.left <= 0)
+			t->dl.throttled = true;
+		break;
+	case SCHED_FIFO:
+		if (c->rt_time == 0)
+			c->rt_window_end = now + RT_PERIOD;
+		c->rt_time += delta;
+		if (c->rt_time >= RT_RUNTIME) {
+			spin_lock (&c->rq.lock);
+			c->rq.rt_throttled = true;
+			spin_unlock (&c->rq.lock);
 		}
-		else t = list_next(t);
+		break;
+	default:
+		cfs_charge (t, delta);
+		break;
+	}
+}
+
+/* Returns true if T, the running thread, should give up the CPU
+   to a ready thread: a thread of a higher class, or of the same
+   class with an earlier deadline (SCHED_DEADLINE) or a higher
+   priority (SCHED_FIFO and the priority scheduler); under CFS,
+   the leftmost ready thread if T's slice is used up or if that
+   thread has fallen more than CFS_WAKEUP_GRANULARITY behind T.
+   A SCHED_DEADLINE thread out of budget and a SCHED_FIFO thread
+   out of bandwidth give up the CPU as well.  T should have just
+   been charged.  Must be called with interrupts off. */
+static bool
+thread_should_preempt (struct thread *t) {
+	struct runqueue *rq = &t->cpu->rq;
+	enum sched_policy top;
+	bool preempt;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t == t->cpu->idle_thread)
+		return rq->cnt > 0;
+	if (t->policy == SCHED_DEADLINE && t->dl.throttled)
+		return true;
+
+	spin_lock (&rq->lock);
+	if (rq->cnt == 0)
+		preempt = false;
+	else if ((top = rq_top_policy (rq)) != t->policy)
+		preempt = top > t->policy
+			|| (t->policy == SCHED_FIFO && rq->rt_throttled);
+	else if (top == SCHED_DEADLINE)
+		preempt = rb_entry (rb_min (&rq->dl_tree), struct thread,
+				rb_elem)->dl.abs_deadline < t->dl.abs_deadline;
+	else if (top == SCHED_FIFO)
+		preempt = pq_entry (pq_max (&rq->rt_queue), struct thread,
+				rt_elem)->rt_priority > t->rt_priority;
+	else if (thread_cfs) {
+		struct thread *left = rb_entry (rb_min (&rq->cfs_tree),
+				struct thread, rb_elem);
+		preempt = t->exec_start >= t->cpu->slice_end
+			|| left->vruntime + CFS_WAKEUP_GRANULARITY < t->vruntime;
+	} else
+		preempt = t->priority < rq_max_priority (rq);
+	spin_unlock (&rq->lock);
+	return preempt;
+}
+
+/* Returns true if A ranks at least as high as B: A is of a
+   higher class, or of the same class with a deadline no later
+   (SCHED_DEADLINE), a priority no lower (SCHED_FIFO and the
+   priority scheduler) or, under CFS, a vruntime no greater. */
+static bool
+thread_ranks_at_least (const struct thread *a, const struct thread *b) {
+	if (a->policy != b->policy)
+		return a->policy > b->policy;
+	switch (a->policy) {
+	case SCHED_DEADLINE:
+		return a->dl.abs_deadline <= b->dl.abs_deadline;
+	case SCHED_FIFO:
+		return a->rt_priority >= b->rt_priority;
+	default:
+		if (thread_cfs)
+			return a->vruntime <= b->vruntime;
+		return a->priority >= b->priority;
+	}
+}
+
+/* Charges T, the running thread, for DELTA ns under CFS, and
+   advances the min_vruntime of its run queue.  Must be called
+   with interrupts off. */
+static void
+cfs_charge (struct thread *t, uint64_t delta) {
+	struct runqueue *rq = &t->cpu->rq;
+	int64_t min;
+
+	t->vruntime += delta * NICE_0_WEIGHT / cfs_weight (t);
+
+	/* min_vruntime follows the least vruntime of the runnable
+	   threads, but never goes backward. */
+	min = t->vruntime;
+	spin_lock (&rq->lock);
+	if (!rb_empty (&rq->cfs_tree)) {
+		struct thread *left = rb_entry (rb_min (&rq->cfs_tree),
+				struct thread, rb_elem);
+		if (left->vruntime < min)
+			min = left->vruntime;
 	}
-}
\ No newline at end of file
+	if (min > rq->min_vruntime)
+		rq->min_vruntime = min;
+	spin_unlock (&rq->lock);
+}
+
+/* Returns the length in ns of the slice that T, about to run,
+   gets among the CFS threads in RQ. */
+static uint64_t
+cfs_slice (const struct thread *t, const struct runqueue *rq) {
+	uint64_t nr_running = rb_size (&rq->cfs_tree) + 1;
+	uint64_t period = CFS_LATENCY;
+
+	if (period < nr_running * CFS_MIN_GRANULARITY)
+		period = nr_running * CFS_MIN_GRANULARITY;
+	return period * cfs_weight (t) / (rq->cfs_load + cfs_weight (t));
+}
+
+/* Orders SCHED_FIFO threads by real-time priority. */
+static bool
+rt_less (const struct pq_elem *a, const struct pq_elem *b,
+		void *aux UNUSED) {
+	return pq_entry (a, struct thread, rt_elem)->rt_priority
+		< pq_entry (b, struct thread, rt_elem)->rt_priority;
+}
+
+/* Orders SCHED_DEADLINE threads by absolute deadline. */
+static bool
+dl_less (const struct rb_node *a, const struct rb_node *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct thread, rb_elem)->dl.abs_deadline
+		< rb_entry (b, struct thread, rb_elem)->dl.abs_deadline;
+}
+
+/* Called when SCHED_DEADLINE thread T wakes up.  If T's current
+   deadline has passed, or T could not use the rest of its budget
+   by that deadline without exceeding its reserved bandwidth, T
+   starts a new period now, with a full budget; this is the rule
+   of the constant bandwidth server, which keeps a thread that
+   blocks from hurting the others' guarantees.  A thread woken by
+   dl_replenish() keeps the period it was given there.  Returns
+   false if T is still out of budget, in which case it stays
+   blocked until its budget is replenished.  Must be called with
+   interrupts off. */
+static bool
+dl_wakeup (struct thread *t) {
+	struct sched_dl *dl = &t->dl;
+	uint64_t now = timer_now_ns ();
+
+	if (dl->throttled) {
+		if (dl->left > 0) {
+			dl->throttled = false;
+			return true;
+		}
+		if (!dl->timer.armed)
+			hrtimer_start (&dl->timer, dl->period_start + dl->period);
+		return false;
+	}
+	if (now >= dl->abs_deadline
+			|| (unsigned __int128) dl->left * dl->period
+			> (unsigned __int128) dl->runtime * (dl->abs_deadline - now)) {
+		dl->period_start = now;
+		dl->abs_deadline = now + dl->deadline;
+		dl->left = dl->runtime;
+	}
+	return true;
+}
+
+/* Replenishes the budget of the throttled SCHED_DEADLINE thread
+   whose timer TIMER is, at the start of its next period, and
+   wakes it up. */
+static void
+dl_replenish (struct hrtimer *timer) {
+	struct thread *t = timer->aux;
+	struct sched_dl *dl = &t->dl;
+	uint64_t now = timer_now_ns ();
+
+	ASSERT (t->status == THREAD_BLOCKED);
+	ASSERT (dl->throttled);
+
+	/* Budget overrun in the last period is paid back in this
+	   one.  A thread that fell a whole deadline behind starts
+	   over from now. */
+	dl->period_start += dl->period;
+	if (dl->period_start + dl->deadline <= now)
+		dl->period_start = now;
+	dl->abs_deadline = dl->period_start + dl->deadline;
+	dl->left += dl->runtime;
+	if (dl->left > (int64_t) dl->runtime)
+		dl->left = dl->runtime;
+	thread_unblock (t);
+	thread_test_preemption ();
+}
+
+/* Gives back T's SCHED_DEADLINE reservation, if it has one.
+   Must be called with interrupts off. */
+static void
+dl_release (struct thread *t) {
+	if (t->policy == SCHED_DEADLINE) {
+		hrtimer_cancel (&t->dl.timer);
+		dl_total_bw -= t->dl.bw;
+		t->dl.bw = 0;
+		t->policy = SCHED_NORMAL;
+	}
+}
+
+/* Charges the running thread for the time it spent in the kernel
+   since it last entered it or was switched to.  Must be called
+   with interrupts off. */
+static void
+thread_charge_kernel (void) {
+	struct thread *t = running_thread ();
+	uint64_t now = timer_now_ns ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	t->ru.stime += now - t->ru_stamp;
+	t->ru_stamp = now;
+}
+
+/* Inserts T into TOP, which holds *CNT of at most RU_TOP_CNT
+   threads in decreasing order of CPU time, if T used more than
+   the last of them. */
+static void
+ru_top_insert (struct ru_top *top, size_t *cnt, const struct thread *t) {
+	uint64_t time = t->ru.utime + t->ru.stime;
+	size_t i;
+
+	for (i = *cnt; i > 0; i--) {
+		if (top[i - 1].ru.utime + top[i - 1].ru.stime >= time)
+			break;
+		if (i < RU_TOP_CNT)
+			top[i] = top[i - 1];
+	}
+	if (i >= RU_TOP_CNT)
+		return;
+
+	top[i].tid = t->tid;
+	strlcpy (top[i].name, t->name, sizeof top[i].name);
+	top[i].ru = t->ru;
+	if (*cnt < RU_TOP_CNT)
+		(*cnt)++;
+}
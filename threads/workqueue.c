@@ -0,0 +1,277 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A workqueue, served by a pool of worker threads.  A worker that
+   wakes up takes all of the pending work at once and runs it as
+   one batch.  The members are protected by disabling interrupts,
+   since work may be queued from interrupt handlers. */
+struct workqueue {
+	struct list pending;        /* Queued work, oldest first. */
+	struct list idle;           /* Blocked workers. */
+	size_t busy_cnt;            /* Workers running a batch. */
+	struct list flushers;       /* Threads in flush_workqueue(). */
+};
+
+/* A worker thread, while it is blocked for lack of work. */
+struct idle_worker {
+	struct list_elem elem;      /* Element in the `idle' list. */
+	struct thread *thread;
+};
+
+/* A thread waiting in flush_workqueue(). */
+struct flusher {
+	struct list_elem elem;      /* Element in the `flushers' list. */
+	struct semaphore done;      /* Upped once the queue is drained. */
+};
+
+/* Workqueue for work that has no need of its own. */
+struct workqueue *system_wq;
+
+static thread_func worker;
+static void enqueue (struct workqueue *, struct work *);
+static void delayed_work_timer (struct hrtimer *);
+
+/* Creates the system workqueue, with one worker per CPU.  Must be
+   called after the thread system has been started. */
+void
+workqueue_init (void) {
+	system_wq = workqueue_create ("kworker", PRI_DEFAULT, cpu_cnt);
+	if (system_wq == NULL)
+		PANIC ("cannot create system workqueue");
+}
+
+/* Initializes WORK to call FUNC, which may use AUX as it likes. */
+void
+work_init (struct work *work, work_func *func, void *aux) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->aux = aux;
+	work->pending = false;
+}
+
+/* Initializes DWORK to call FUNC, which may use AUX as it likes
+   and finds DWORK as the `work' member's container. */
+void
+delayed_work_init (struct delayed_work *dwork, work_func *func,
+		void *aux) {
+	work_init (&dwork->work, func, aux);
+	hrtimer_init (&dwork->timer, delayed_work_timer, dwork);
+	dwork->wq = NULL;
+}
+
+/* Creates a workqueue named NAME with THREAD_CNT worker threads
+   of the given PRIORITY.  (Under the MLFQS, the workers' priority
+   is computed like any other thread's.)  Returns the new queue, or
+   a null pointer if not even one worker could be created.
+   Workqueues are never destroyed. */
+struct workqueue *
+workqueue_create (const char *name, int priority, size_t thread_cnt) {
+	struct workqueue *wq;
+	size_t i;
+
+	ASSERT (name != NULL);
+	ASSERT (thread_cnt > 0);
+
+	wq = malloc (sizeof *wq);
+	if (wq == NULL)
+		return NULL;
+	list_init (&wq->pending);
+	list_init (&wq->idle);
+	wq->busy_cnt = 0;
+	list_init (&wq->flushers);
+
+	for (i = 0; i < thread_cnt; i++) {
+		char thread_name[32];
+
+		snprintf (thread_name, sizeof thread_name, "%s/%zu", name, i);
+		if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+			break;
+	}
+	if (i == 0) {
+		free (wq);
+		return NULL;
+	}
+	return wq;
+}
+
+/* Queues WORK on WQ, to be run by one of its workers.  Returns
+   true if WORK was queued, or false if it was already pending.
+   May be called from an interrupt handler.  WORK may be queued
+   again, or freed, by its own function.
+
+   A worker that is woken up does not preempt a caller that has
+   interrupts off until they are turned back on, so that work
+   queued together is run together. */
+bool
+queue_work (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool queued;
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	queued = !work->pending;
+	if (queued) {
+		work->pending = true;
+		enqueue (wq, work);
+	}
+	intr_set_level (old_level);
+	if (queued && old_level == INTR_ON)
+		thread_test_preemption ();
+	return queued;
+}
+
+/* Queues DWORK on WQ once TICKS timer ticks have passed, or at
+   once if TICKS is not positive.  Returns true if DWORK was
+   queued, or false if it was already pending. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dwork,
+		int64_t ticks) {
+	enum intr_level old_level;
+	bool queued;
+
+	ASSERT (wq != NULL);
+	ASSERT (dwork != NULL);
+
+	old_level = intr_disable ();
+	queued = !dwork->work.pending;
+	if (queued) {
+		dwork->work.pending = true;
+		dwork->wq = wq;
+		if (ticks <= 0)
+			enqueue (wq, &dwork->work);
+		else
+			hrtimer_start (&dwork->timer,
+					timer_now_ns () + ticks * (NSEC_PER_SEC / TIMER_FREQ));
+	}
+	intr_set_level (old_level);
+	if (queued && ticks <= 0 && old_level == INTR_ON)
+		thread_test_preemption ();
+	return queued;
+}
+
+/* Cancels DWORK if its delay has not yet run out.  Returns true
+   if it was cancelled, or false if it was not pending or had
+   already been put on its workqueue. */
+bool
+cancel_delayed_work (struct delayed_work *dwork) {
+	enum intr_level old_level;
+	bool cancelled;
+
+	old_level = intr_disable ();
+	cancelled = hrtimer_cancel (&dwork->timer);
+	if (cancelled)
+		dwork->work.pending = false;
+	intr_set_level (old_level);
+	return cancelled;
+}
+
+/* Waits until WQ has no work pending or running, which includes
+   all of the work queued on it before the call.  Delayed work
+   whose delay has not run out is not waited for.  Must not be
+   called by one of WQ's own workers. */
+void
+flush_workqueue (struct workqueue *wq) {
+	struct flusher flusher;
+	enum intr_level old_level;
+
+	ASSERT (wq != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (list_empty (&wq->pending) && wq->busy_cnt == 0) {
+		intr_set_level (old_level);
+		return;
+	}
+	sema_init (&flusher.done, 0);
+	list_push_back (&wq->flushers, &flusher.elem);
+	intr_set_level (old_level);
+
+	sema_down (&flusher.done);
+}
+
+/* Appends WORK to WQ.  A worker is woken only for the first work
+   in an empty queue; later work joins the batch that worker will
+   take.  Interrupts must be off. */
+static void
+enqueue (struct workqueue *wq, struct work *work) {
+	bool was_empty = list_empty (&wq->pending);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	list_push_back (&wq->pending, &work->elem);
+	if (was_empty && !list_empty (&wq->idle))
+		thread_unblock (list_entry (list_pop_front (&wq->idle),
+				struct idle_worker, elem)->thread);
+}
+
+/* Puts the work of the delayed work whose TIMER expired on its
+   workqueue. */
+static void
+delayed_work_timer (struct hrtimer *timer) {
+	struct delayed_work *dwork = timer->aux;
+
+	enqueue (dwork->wq, &dwork->work);
+	thread_test_preemption ();
+}
+
+/* Body of a worker thread of workqueue WQ_. */
+static void
+worker (void *wq_) {
+	struct workqueue *wq = wq_;
+	struct idle_worker self;
+
+	self.thread = thread_current ();
+	for (;;) {
+		struct list batch;
+		enum intr_level old_level;
+
+		/* Wait for work, then take all of it. */
+		old_level = intr_disable ();
+		while (list_empty (&wq->pending)) {
+			list_push_back (&wq->idle, &self.elem);
+			thread_block ();
+		}
+		list_init (&batch);
+		list_splice (list_end (&batch), list_begin (&wq->pending),
+				list_end (&wq->pending));
+		wq->busy_cnt++;
+		intr_set_level (old_level);
+
+		/* Run it.  Each work stops being pending as it starts, so
+		   that it can be queued again, and may free itself. */
+		while (!list_empty (&batch)) {
+			struct work *work;
+
+			old_level = intr_disable ();
+			work = list_entry (list_pop_front (&batch), struct work, elem);
+			work->pending = false;
+			intr_set_level (old_level);
+			work->func (work);
+		}
+
+		/* Release the flushers once the queue is drained.  Take
+		   them all first: sema_up() may switch to another thread,
+		   which may queue more work and start flushing it. */
+		old_level = intr_disable ();
+		wq->busy_cnt--;
+		list_init (&batch);
+		if (wq->busy_cnt == 0 && list_empty (&wq->pending))
+			list_splice (list_end (&batch), list_begin (&wq->flushers),
+					list_end (&wq->flushers));
+		while (!list_empty (&batch))
+			sema_up (&list_entry (list_pop_front (&batch),
+					struct flusher, elem)->done);
+		intr_set_level (old_level);
+	}
+}
@@ -11,9 +11,11 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -29,6 +31,15 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static struct process *process_alloc (struct process *parent);
+static void process_free (struct process *);
+
+/* Cache of process structures. */
+static struct kmem_cache *process_cache;
+
+/* Back aligned 2 MB runs of user memory with large pages?  Turned
+   off by the -nothp kernel option. */
+bool thp_enabled = true;
 
 void hex_dump (uintptr_t ofs, const void *buf_, size_t size, bool ascii);
 /* General process initializer for initd and other process. */
@@ -37,6 +48,85 @@ process_init (void) {
 	struct thread *current = thread_current ();
 }
 
+/* Initializes the process cache. */
+void
+process_cache_init (void) {
+	process_cache = kmem_cache_create ("process", sizeof (struct process),
+			NULL);
+	if (process_cache == NULL)
+		PANIC ("cannot create process cache");
+}
+
+/* Allocates and initializes a process as a child of PARENT, or
+   as an orphan if PARENT is null.  Returns a null pointer if
+   memory is exhausted. */
+static struct process *
+process_alloc (struct process *parent) {
+	struct process *p;
+	enum intr_level old_level;
+
+	p = kmem_cache_zalloc (process_cache);
+	if (p == NULL)
+		return NULL;
+	p->pid = TID_ERROR;
+	list_init (&p->children);
+	sema_init (&p->wait_sema, 0);
+	sema_init (&p->fork_sema, 0);
+	p->parent = parent;
+	if (parent != NULL) {
+		old_level = intr_disable ();
+		list_push_back (&parent->children, &p->child_elem);
+		intr_set_level (old_level);
+	}
+	return p;
+}
+
+/* Returns P, which must not be in any parent's list of children,
+   to the process cache. */
+static void
+process_free (struct process *p) {
+	kmem_cache_free (process_cache, p);
+}
+
+/* Unlinks P, which a failed thread_create_in() left without a
+   thread, from its parent and frees it. */
+static void
+process_abandon (struct process *p) {
+	enum intr_level old_level = intr_disable ();
+	if (p->parent != NULL)
+		list_remove (&p->child_elem);
+	intr_set_level (old_level);
+	process_free (p);
+}
+
+/* Returns the running thread's process, or a null pointer for a
+   kernel thread. */
+struct process *
+process_current (void) {
+	return thread_current ()->proc;
+}
+
+/* Returns the calling process's child with the given PID, whether
+   it is still running or has exited but not been waited for, or a
+   null pointer if there is no such child.  Only the process itself
+   adds to or removes from its CHILDREN, so the walk needs neither
+   a lock nor interrupts off. */
+struct process *
+process_get_child (tid_t pid) {
+	struct process *curr = process_current ();
+	struct list_elem *e;
+
+	if (curr == NULL)
+		return NULL;
+	for (e = list_begin (&curr->children); e != list_end (&curr->children);
+			e = list_next (e)) {
+		struct process *p = list_entry (e, struct process, child_elem);
+		if (p->pid == pid)
+			return p;
+	}
+	return NULL;
+}
+
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
  * The new thread may be scheduled (and may even exit)
  * before process_create_initd() returns. Returns the initd's
@@ -44,9 +134,20 @@ process_init (void) {
  * Notice that THIS SHOULD BE CALLED ONCE. */
 tid_t
 process_create_initd (const char *file_name) {
+	struct thread *curr = thread_current ();
+	struct process *child;
 	char *fn_copy;
 	tid_t tid;
 
+	/* The kernel thread that starts initd becomes a process
+	   without an address space, so that it can wait for it. */
+	if (curr->proc == NULL) {
+		curr->proc = process_alloc (NULL);
+		if (curr->proc == NULL)
+			return TID_ERROR;
+		curr->proc->pid = curr->tid;
+	}
+
 	/* Make a copy of FILE_NAME.
 	 * Otherwise there's a race between the caller and load(). */
 	fn_copy = palloc_get_page (0);
@@ -57,9 +158,17 @@ process_create_initd (const char *file_name) {
 	void **save_ptr;
 	strtok_r(file_name," ",save_ptr);
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (file_name, PRI_DEFAULT, initd, fn_copy);
-	if (tid == TID_ERROR)
+	child = process_alloc (curr->proc);
+	if (child == NULL) {
 		palloc_free_page (fn_copy);
+		return TID_ERROR;
+	}
+	tid = child->pid = thread_create_in (child, file_name, PRI_DEFAULT,
+			initd, fn_copy);
+	if (tid == TID_ERROR) {
+		process_abandon (child);
+		palloc_free_page (fn_copy);
+	}
 	return tid;
 }
 
@@ -67,7 +176,7 @@ process_create_initd (const char *file_name) {
 static void
 initd (void *f_name) {
 #ifdef VM
-	supplemental_page_table_init (&thread_current ()->spt);
+	supplemental_page_table_init (&process_current ()->spt);
 #endif
 
 	process_init ();
@@ -81,12 +190,73 @@ initd (void *f_name) {
  * TID_ERROR if the thread cannot be created. */
 tid_t
 process_fork (const char *name, struct intr_frame *if_) {
+	struct process *curr = process_current ();
+	struct process *child;
+	tid_t tid;
+
 	/* Clone current thread to new thread.*/
-	memcpy(&thread_current()->parent_if,if_,sizeof(struct intr_frame)); // 이 코드~!
-	return thread_create (name,PRI_DEFAULT, __do_fork, thread_current ());
+	memcpy(&curr->fork_if,if_,sizeof(struct intr_frame)); // 이 코드~!
+	fpu_sync ();
+	child = process_alloc (curr);
+	if (child == NULL)
+		return TID_ERROR;
+	tid = child->pid = thread_create_in (child, name, PRI_DEFAULT,
+			__do_fork, thread_current ());
+	if (tid == TID_ERROR)
+		process_abandon (child);
+	return tid;
 }
 
 #ifndef VM
+/* Returns a 2 MB user frame, aligned for a large page, or a null
+   pointer if large pages are turned off or the user pool has no
+   such block to spare.  Never reclaims memory to find one, since
+   the caller can always fall back to 4 kB pages. */
+static void *
+get_large_frame (void) {
+	void *frame;
+
+	if (!thp_enabled)
+		return NULL;
+	frame = palloc_get_multiple (PAL_USER | PAL_NORECLAIM,
+			LARGE_PGSIZE / PGSIZE);
+	ASSERT (frame == NULL || vtop (frame) % LARGE_PGSIZE == 0);
+	return frame;
+}
+
+/* Copies the parent's 2 MB page at VA, mapped by PDE, into the
+   current process: into a large page if one is to be had, or else
+   page by page, splitting it into 4 kB pages in the child. */
+static bool
+duplicate_large_pte (uint64_t *pde, void *va, struct thread *parent) {
+	struct thread *current = thread_current ();
+	uint8_t *parent_page = pml4_get_page (parent->proc->pml4, va);
+	bool writable = (*pde & PTE_W) != 0;
+	uint8_t *newpage;
+
+	newpage = get_large_frame ();
+	if (newpage != NULL) {
+		memcpy (newpage, parent_page, LARGE_PGSIZE);
+		if (pml4_set_large_page (current->proc->pml4, va, newpage, writable))
+			return true;
+		palloc_free_multiple (newpage, LARGE_PGSIZE / PGSIZE);
+		return false;
+	}
+
+	for (size_t ofs = 0; ofs < LARGE_PGSIZE; ofs += PGSIZE) {
+		newpage = palloc_get_page (PAL_USER);
+		if (newpage == NULL)
+			return false;
+		memcpy (newpage, parent_page + ofs, PGSIZE);
+		if (!pml4_set_page (current->proc->pml4, (uint8_t *) va + ofs,
+					newpage, writable)) {
+			palloc_free_page (newpage);
+			return false;
+		}
+	}
+	return true;
+}
+
 /* Duplicate the parent's address space by passing this function to the
  * pml4_for_each. This is only for the project 2. */
 bool
@@ -104,11 +274,13 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 		// memcpy(newpage, parent_page, PGSIZE);
 		return true; 
 	}	
+	if (*pte & PTE_PS)
+		return duplicate_large_pte (pte, va, parent);
 	va = pg_round_down(va); // va에 해당하는 페이지의 시작 주소로 슈웃 
 	
 	//if(!is_user_vaddr(va)) return true;
 	/* 2. Resolve VA from the parent's page map level 4. */
-	parent_page = pml4_get_page (parent->pml4, va);
+	parent_page = pml4_get_page (parent->proc->pml4, va);
 	if (!parent_page) return false;
 	/* 3. TODO: Allocate new PAL_USER page for the child and set result to
 	 *    TODO: NEWPAGE. */
@@ -123,7 +295,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE
 	 *    permission. */
-	if (!pml4_set_page (current->pml4, va, newpage, writable)) {
+	if (!pml4_set_page (current->proc->pml4, va, newpage, writable)) {
 		/* 6. TODO: if fail to insert page, do error handling. */	
 		palloc_free_page(newpage);
 		return false;
@@ -142,10 +314,11 @@ __do_fork (void *aux) {
 	struct intr_frame if_;
 	struct thread *parent = (struct thread *) aux; // 부모
 	struct thread *current = thread_current (); // 자식
+	struct process *child = current->proc;
 	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
 	struct intr_frame *parent_if;
 	bool succ = true;
-	parent_if = &parent->parent_if;
+	parent_if = &parent->proc->fork_if;
 	/* 1. Read the cpu context to local stack. */
 	memcpy (&if_,parent_if, sizeof (struct intr_frame)); // tf 
 	// memcpy(&current->tf,parent_if,sizeof(struct intr_frame));
@@ -158,17 +331,17 @@ __do_fork (void *aux) {
 	
 	// printf("parent: %d, child:%d, list_head : %d\n\n",parent->tid, current->tid,list_entry(list_front(&parent->child_list),struct thread,c_elem)->tid);
 	/* 2. Duplicate PT */
-	current->pml4 = pml4_create();
-	if (current->pml4 == NULL)
+	child->pml4 = pml4_create();
+	if (child->pml4 == NULL)
 		goto error;
 
 	process_activate (current);
 #ifdef VM
-	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+	supplemental_page_table_init (&child->spt);
+	if (!supplemental_page_table_copy (&child->spt, &parent->proc->spt))
 		goto error;
 #else
-	if (!pml4_for_each (parent->pml4, duplicate_pte, parent)){
+	if (!pml4_for_each (parent->proc->pml4, duplicate_pte, parent)){
 		goto error;
 	}
 #endif
@@ -179,24 +352,26 @@ __do_fork (void *aux) {
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
 	for( int i = MIN_FD; i <= MAX_FD; i ++){ 
-		if(parent->fdt[i] != NULL){
-			struct file *dup_file = file_duplicate(parent->fdt[i]);
-			current->fdt[i] = dup_file;
+		if(parent->proc->fdt[i] != NULL){
+			struct file *dup_file = file_duplicate(parent->proc->fdt[i]);
+			child->fdt[i] = dup_file;
 		}
 	}
 
 	// 모든 fdt를 전부 복사해야 할듯?
+	if (!fpu_copy (parent))
+		goto error;
 	process_init ();
 
-	sema_up(&current->fork_sema);
+	sema_up(&child->fork_sema);
 	/* Finally, switch to the newly created process. */
 	if (succ){
 		if_.R.rax = 0; // 자식은 0 이어야 함 
 		do_iret (&if_); // t
 	}
 error:
-	current->exit_status = -1;
-	sema_up(&current->fork_sema);
+	child->exit_status = -1;
+	sema_up(&child->fork_sema);
 	sys_exit(-1);
 }
 
@@ -280,6 +455,7 @@ process_exec (void *f_name) {
 	
 	/* We first kill the current context */
 	process_cleanup ();
+	fpu_release (thread_current ());
 	char *file_name = f_name;
 	success = load (file_name, &_if);
 
@@ -309,122 +485,74 @@ process_exec (void *f_name) {
  * been successfully called for the given TID, returns -1
  * immediately, without waiting.
  *
- * This function will be implemented in problem 2-2.  For now, it
- * does nothing. */
-struct thread*
-get_child_process2(tid_t pid){
-	struct thread * curr = thread_current();
-	struct list_elem *e;
-	struct thread * child;
-	
-	//printf("get_child_process: list head : %d\n\n",list_entry(list_front(&curr->child_list),struct thread,c_elem)->tid);
-	
-	for (e = list_begin (&curr->child_list); e != list_end (&curr->child_list); e = list_next (e)){
-		child = list_entry(e,struct thread,c_elem);
-		if(child->tid == pid){ 
-			return child;
-		}
-	}
-	return NULL; // not exist!
-}
-
-// struct thread*
-// get_killed_child(int child_tid){
-// 	struct thread * curr = thread_current();
-// 	struct list_elem *e;
-// 	struct thread * child;
-	
-// 	//printf("get_child_process: list head : %d\n\n",list_entry(list_front(&curr->child_list),struct thread,c_elem)->tid);
-	
-// 	for (e = list_begin (&curr->killed_list); e != list_end (&curr->killed_list); e = list_next (e)){
-// 		child = list_entry(e,struct thread,k_elem);
-// 		if(child->tid == child_tid){ 
-// 			return child;
-// 		}
-// 	}
-// 	return NULL; // not exist!
-// }
-
+ * The child's process structure is freed once its status has
+ * been collected. */
 int
-process_wait (tid_t child_tid UNUSED) {
-	
-	struct thread * cur = thread_current();
-	// printf("get before\n\n");
-	cur->waiting_child = child_tid;
-	struct thread * target = get_child_process2(child_tid);
-	if(!target) {
-		//printf("no target!\n");
-		return -1;
-	}
-	// kill_list -> 이미 wait이 호출되었으면서 아직 exit안한 애들 -> 호출이 또되면 -1
+process_wait (tid_t child_tid) {
+	struct process *child = process_get_child (child_tid);
+	enum intr_level old_level;
+	int status;
 
-	// if (get_killed_child(child_tid)){
-	// 	return -1;
-	// }
-	//list_push_back(&cur->killed_list,&target->k_elem);
+	if (child == NULL)
+		return -1;
 
-	sema_down(&target->wait_sema);
-	
-	int exit_s = target->exit_status;
-	
-	list_remove(&target->c_elem);
-	// list_remove(&target->k_elem);
-	target->parent = NULL;
+	sema_down (&child->wait_sema);
+	status = child->exit_status;
 
-	// sema_up(&target->exit_sema);
-	
-	return exit_s; 
-	//return thread_current()->exit_status;// child의 exit_status를 리턴하도록 하기 
+	old_level = intr_disable ();
+	list_remove (&child->child_elem);
+	intr_set_level (old_level);
+	process_free (child);
+	return status;
 }
 
 /* Exit the process. This function is called by thread_exit (). */
 void
 process_exit (void) {
 	struct thread *curr = thread_current ();
-	/* TODO: Your code goes here.
-	 * TODO: Implement process term	ination message (see
-	 * TODO: project2/process_termination.html).
-	 * TODO: We recommend you to implement process resource cleanup here. */
-	// if(curr->parent && curr->parent->waiting_child == curr ->tid){
-		// list_push_back(&ready_list,&thread_current()->parent->elem);
-		// thread_yield();
-		// curr->parent->exit_status = curr->exit_status;
-	// curr->parent->child_exit_status = curr->exit_status;
+	struct process *p = curr->proc;
+	struct rusage ru;
+	enum intr_level old_level;
+
+	if (p == NULL)
+		return;
 
 	for (int i = MIN_FD; i <= MAX_FD; i++)
-    	sys_close(i);
+		sys_close(i);
 
-	if(curr->loaded_file) file_close(curr->loaded_file);
+	if(p->loaded_file) file_close(p->loaded_file);
+	process_cleanup ();
 
-	struct exit_info *my_info;
-    my_info = (struct exit_info *)malloc(sizeof(struct exit_info));
-    my_info->pid = curr->tid;
-	my_info->exit_status = curr->exit_status;
-	list_push_back(&curr->parent->exit_child_list,&my_info->p_elem);
-	
-	
-	//list_remove(&curr->c_elem);
-	// for (int i = 2; i < 63; i++)
-	// 	sys_close(i);
-	// if(curr->loaded_file) {
-	// 	printf("loaded file released! pid == %d\n ",curr->tid);
-	// 	file_close(curr->loaded_file);
-	// }
-	
-	sema_up(&curr->wait_sema);
-	// sema_down(&curr->exit_sema);
-	while(!list_empty(&curr->exit_child_list)){
-		//printf("cur: %d , freed pid : %d \n",curr->tid,list_entry(list_back(&curr->exit_child_list),struct exit_info,p_elem)->pid);
-		free(list_entry(list_pop_back(&curr->exit_child_list),struct exit_info,p_elem));
+	thread_get_rusage (&ru);
+
+	old_level = intr_disable ();
+	/* Children that have exited can no longer be waited for, and
+	   those still running will free themselves. */
+	while (!list_empty (&p->children)) {
+		struct process *child = list_entry (list_pop_front (&p->children),
+				struct process, child_elem);
+		child->parent = NULL;
+		if (child->exited)
+			process_free (child);
 	}
-	process_cleanup ();
 
+	/* After this, P belongs to the parent, which may free it as
+	   soon as WAIT_SEMA is upped. */
+	curr->proc = NULL;
+	p->exited = true;
+	if (p->parent != NULL) {
+		rusage_add (&p->parent->child_ru, &ru);
+		rusage_add (&p->parent->child_ru, &p->child_ru);
+		sema_up (&p->wait_sema);
+	} else
+		process_free (p);
+	intr_set_level (old_level);
 }
 
 /* Free the current process's resources. */
 static void
 process_cleanup (void) {
-	struct thread *curr = thread_current ();
+	struct process *curr = process_current ();
 
 #ifdef VM
 	supplemental_page_table_kill (&curr->spt);
@@ -453,7 +581,7 @@ process_cleanup (void) {
 void
 process_activate (struct thread *next) {
 	/* Activate thread's page tables. */
-	pml4_activate (next->pml4);
+	pml4_activate (next->proc != NULL ? next->proc->pml4 : NULL);
 
 	/* Set thread's kernel stack for use in processing interrupts. */
 	tss_update (next);
@@ -524,7 +652,7 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
  * Returns true if successful, false otherwise. */
 static bool
 load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
+	struct process *p = process_current ();
 	struct ELF ehdr;
 	struct file *file = NULL;
 	off_t file_ofs;
@@ -541,14 +669,14 @@ load (const char *file_name, struct intr_frame *if_) {
 		argv[argc] = token;
 		argc++;
 	}
-	if( t->loaded_file != NULL){
-		file_allow_write(t->loaded_file);
-		t->loaded_file = NULL;
+	if( p->loaded_file != NULL){
+		file_allow_write(p->loaded_file);
+		p->loaded_file = NULL;
 	}
 
 	/* Allocate and activate page directory. */
-	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
+	p->pml4 = pml4_create ();
+	if (p->pml4 == NULL)
 		goto done;
 	process_activate (thread_current ());
 
@@ -562,7 +690,7 @@ load (const char *file_name, struct intr_frame *if_) {
 	}
 
 	file_deny_write(file);
-	t->loaded_file = file;
+	p->loaded_file = file;
 	//lock_release(&sysfile_lock);
 
 	/* Read and verify executable header. */
@@ -724,6 +852,39 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 	file_seek (file, ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
+		/* Fill a whole 2 MB-aligned run with one large page, if the
+		 * segment covers it and an aligned frame is free. */
+		if ((uint64_t) upage % LARGE_PGSIZE == 0
+				&& read_bytes + zero_bytes >= LARGE_PGSIZE) {
+			uint8_t *kpage = get_large_frame ();
+
+			/* Map the frame before reading into it: if a page table
+			 * already covers part of the run, the file position is
+			 * still untouched and the 4 kB path below can take over. */
+			if (kpage != NULL && !pml4_set_large_page (process_current ()->pml4,
+						upage, kpage, writable)) {
+				palloc_free_multiple (kpage, LARGE_PGSIZE / PGSIZE);
+				kpage = NULL;
+			}
+			if (kpage != NULL) {
+				size_t large_read_bytes = read_bytes < LARGE_PGSIZE
+					? read_bytes : LARGE_PGSIZE;
+
+				/* On a short read the frame stays mapped, to be freed
+				 * with the rest of the address space. */
+				if (file_read (file, kpage, large_read_bytes)
+						!= (int) large_read_bytes)
+					return false;
+				memset (kpage + large_read_bytes, 0,
+						LARGE_PGSIZE - large_read_bytes);
+
+				read_bytes -= large_read_bytes;
+				zero_bytes -= LARGE_PGSIZE - large_read_bytes;
+				upage += LARGE_PGSIZE;
+				continue;
+			}
+		}
+
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
 		 * and zero the final PAGE_ZERO_BYTES bytes. */
@@ -785,12 +946,12 @@ setup_stack (struct intr_frame *if_) {
  * if memory allocation fails. */
 static bool
 install_page (void *upage, void *kpage, bool writable) {
-	struct thread *t = thread_current ();
+	struct process *p = process_current ();
 
 	/* Verify that there's not already a page at that virtual
 	 * address, then map our page there. */
-	return (pml4_get_page (t->pml4, upage) == NULL
-			&& pml4_set_page (t->pml4, upage, kpage, writable));
+	return (pml4_get_page (p->pml4, upage) == NULL
+			&& pml4_set_page (p->pml4, upage, kpage, writable));
 }
 #else
 /* From here, codes will be used after project 3.
@@ -46,9 +46,18 @@ int sys_write(int fd, const void* buffer, unsigned size);
 void sys_seek(int fd, unsigned position);
 unsigned sys_tell(int fd);
 void sys_close(int fd);
+int sys_getrusage(int who, struct rusage *usage);
 bool pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux);
 void
 syscall_init (void) {
+	syscall_init_ap ();
+	lock_init(&sysfile_lock);
+}
+
+/* Points the running CPU's syscall MSRs at syscall_entry.
+   Every CPU has its own copy of these registers. */
+void
+syscall_init_ap (void) {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -58,13 +67,12 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-
-	lock_init(&sysfile_lock);
 }
 
 /* The main system call interface */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
+	thread_enter_kernel ();
 
 	/* Projects 2 and later. */
 	// SYS_HALT,                   /* Halt the operating system. */
@@ -127,7 +135,11 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_CLOSE:
 			sys_close(f->R.rdi);
 			break;
+		case SYS_GETRUSAGE:
+			f->R.rax = sys_getrusage(f->R.rdi, (struct rusage *) f->R.rsi);
+			break;
 	}
+	thread_leave_kernel ();
 }
 
 
@@ -138,43 +150,16 @@ sys_halt(void){
 
 void
 sys_exit(int status){
-	thread_current()->exit_status = status;
+	if (process_current () != NULL)
+		process_current ()->exit_status = status;
 
-	printf("%s: exit(%d)\n",thread_current()->name, thread_current()->exit_status);
+	printf("%s: exit(%d)\n",thread_current()->name, status);
 	// for(int i=0; i<63; i++){
-	// 	thread_current()->fdt[i] = NULL;
+	// 	process_current()->fdt[i] = NULL;
 	// }
 	thread_exit();
 }
 
-struct thread*
-get_child_process(pid_t pid){
-	struct thread * curr = thread_current();
-	struct list_elem *e;
-	struct thread * child;
-	for (e = list_begin (&curr->child_list); e != list_end (&curr->child_list); e = list_next (e)){
-		child = list_entry(e,struct thread,c_elem);
-		if(child->tid == pid){
-			return child;
-		}
-	}
-	return NULL; // not exist!
-}
-
-void
-remove_child_process(pid_t pid){ // 자식 스레드의 메모리도 해제 해야 함? 즉, thread_exit()  사용해야함?
-	struct thread * curr = thread_current();
-	struct list_elem *e;
-	struct thread * child;
-	for (e = list_begin (&curr->child_list); e != list_end (&curr->child_list); e = list_next (e)){
-		child = list_entry(e,struct thread,c_elem);
-		if(child->tid == pid){
-			list_remove(e);
-			return;
-		}
-	}
-	return; // not exist!
-}
 // struct thread_args {
 //     	uint64_t *pml4;                     // 첫 번째 필드: 포인터 타입
 //     	void *pte_func;      // 두 번째 필드: 함수 포인터 타입
@@ -189,14 +174,16 @@ pid_t
 sys_fork(const char* thread_name,struct intr_frame *f ){
 
 	// struct thread_args args;
-	// args.pml4 = thread_current()->pml4;
+	// args.pml4 = process_current()->pml4;
 	// args.pte_func = *duplicate_pte;
 	// args.aux = NULL;
 
 	// pid_t child = thread_create(thread_name, thread_current()->priority, thread_function_wrapper, &args);
 	
 	int pid = process_fork(thread_name,f); 
-	struct thread * child = get_child_process(pid);
+	if (pid == TID_ERROR)
+		return -1;
+	struct process * child = process_get_child(pid);
 	sema_down(&child->fork_sema); 
 	if (child->exit_status == -1) {
 		return -1;
@@ -207,7 +194,7 @@ sys_fork(const char* thread_name,struct intr_frame *f ){
 
 int
 sys_exec(const char *cmd_line){
-	if(!pml4_get_page(thread_current()->pml4,cmd_line)) { // 일단 아님..
+	if(!pml4_get_page(process_current()->pml4,cmd_line)) { // 일단 아님..
 		sys_exit(-1);
 	}
 
@@ -242,32 +229,9 @@ sys_exec(const char *cmd_line){
 // 		sys_exit(-1);
 // }
 
-int
-get_exit_child_process(pid_t pid){
-	struct thread * curr = thread_current();
-	struct list_elem *e;
-	struct exit_info * cur_info;
-	for (e = list_begin (&curr->exit_child_list); e != list_end (&curr->exit_child_list); e = list_next (e)){
-		cur_info = list_entry(e,struct exit_info,p_elem);
-		if(cur_info->pid == pid){
-			int i = cur_info->exit_status;
-			return i;
-		}
-	}
-	return -1; // not exist!
-}
-
 int
 sys_wait(pid_t pid){ 
 	// 자식 끝날때까지 기다리는 함수
-	if(thread_current()->waiting_child == pid) return -1; // for test
-
-	int exit_pid;
-	if(exit_pid = get_exit_child_process(pid) != -1) {
-		thread_current()->waiting_child = pid;
-		return get_exit_child_process(pid);
-	}
-	thread_current()->waiting_child = pid;
 	return process_wait(pid);
 }
 
@@ -279,7 +243,7 @@ sys_create(const char *file, unsigned initial_size,uintptr_t rsp){
 	*/
 	// printf("\n create file addr:%p\n",file);
 	
-	if(!pml4_get_page(thread_current()->pml4,file)) { // file 주소에 할당된 페이지가 있나없나.. 
+	if(!pml4_get_page(process_current()->pml4,file)) { // file 주소에 할당된 페이지가 있나없나.. 
 		sys_exit(-1);
 	}
 
@@ -294,7 +258,7 @@ sys_create(const char *file, unsigned initial_size,uintptr_t rsp){
 
 bool
 sys_remove(const char* file){
-	if(!pml4_get_page(thread_current()->pml4,file)) { // 일단 아님..
+	if(!pml4_get_page(process_current()->pml4,file)) { // 일단 아님..
 		sys_exit(-1);
 	}
 
@@ -304,7 +268,7 @@ sys_remove(const char* file){
 int
 sys_open(const char *file){
 	if(!is_user_vaddr(file)) return -1;
-	if(!pml4_get_page(thread_current()->pml4,file)) {
+	if(!pml4_get_page(process_current()->pml4,file)) {
 		sys_exit(-1);
 	}
 	if(file[0] == '\0')return -1; // empty에서 출력 형식 맞추기 
@@ -317,7 +281,7 @@ sys_open(const char *file){
 
 	lock_acquire(&sysfile_lock);
 	for(int i=3 ; i<= 63;i++){
-		if (thread_current()->fdt[i] == NULL){
+		if (process_current()->fdt[i] == NULL){
 			struct file *fd = filesys_open(file);
 			if ( !fd ) {
 				lock_release(&sysfile_lock);
@@ -325,7 +289,7 @@ sys_open(const char *file){
 			}
 			else{
 				// printf("\nopen : fd = %d\n",i);
-				thread_current()->fdt[i] = fd;
+				process_current()->fdt[i] = fd;
 				lock_release(&sysfile_lock);
 				return i;
 			}
@@ -338,13 +302,13 @@ sys_open(const char *file){
 
 int 
 sys_filesize(int fd){
-	return file_length(thread_current()->fdt[fd]);
+	return file_length(process_current()->fdt[fd]);
 }
 
 int
 sys_read(int fd, void *buffer, unsigned size){
 	
-	if(!pml4_get_page(thread_current()->pml4,buffer)) { 
+	if(!pml4_get_page(process_current()->pml4,buffer)) { 
 		sys_exit(-1);
 	}
 	
@@ -362,13 +326,13 @@ sys_read(int fd, void *buffer, unsigned size){
 		return -1;
 	}
 	// lock 잡아주기
-	if( thread_current()->fdt[fd] == NULL){
+	if( process_current()->fdt[fd] == NULL){
 		
 		lock_release(&sysfile_lock);	
 		return -1;
 	}
 	// printf("\nread : fd = %d\n",fd);
-	file_size = file_read(thread_current()->fdt[fd],buffer,size);
+	file_size = file_read(process_current()->fdt[fd],buffer,size);
 	lock_release(&sysfile_lock);
 
 	return file_size;
@@ -377,7 +341,7 @@ int
 sys_write(int fd, const void* buffer, unsigned size){
 	// printf("sys_write inside!\n");
 	// printf("fd:%d, buffer:%s",fd,buffer);
-	if(!pml4_get_page(thread_current()->pml4,buffer)) { 
+	if(!pml4_get_page(process_current()->pml4,buffer)) { 
 		sys_exit(-1);
 	}
 	lock_acquire(&sysfile_lock);
@@ -392,36 +356,56 @@ sys_write(int fd, const void* buffer, unsigned size){
 		lock_release(&sysfile_lock);
 		sys_exit(-1);
 	}
-	if ( thread_current()->fdt[fd] == NULL) {
+	if ( process_current()->fdt[fd] == NULL) {
 		lock_release(&sysfile_lock);
 		return 0; // 아직 해당 fd가 존재하지 않는 경우 -> return 0
 	}
 	// printf("\nwrite : fd = %d\n",fd);
-	int write_result = file_write(thread_current()->fdt[fd], buffer, size);
+	int write_result = file_write(process_current()->fdt[fd], buffer, size);
 	lock_release(&sysfile_lock);
 	return write_result;
 }
 
 void
 sys_seek(int fd, unsigned position){ // 예외처리 아직 안함
-	file_seek(thread_current()->fdt[fd],position);
+	file_seek(process_current()->fdt[fd],position);
 	return;
 }
 
 unsigned
 sys_tell(int fd){
-	return file_tell(thread_current()->fdt[fd]);
+	return file_tell(process_current()->fdt[fd]);
 }
 
 void
 sys_close(int fd){
-	// if(!pml4_get_page(thread_current()->pml4,fd)) { 
+	// if(!pml4_get_page(process_current()->pml4,fd)) { 
 	// 	sys_exit(-1);
 	// }
 	if (fd < 0 || fd > 63) return;
-	if (thread_current()->fdt[fd] == NULL) return;
+	if (process_current()->fdt[fd] == NULL) return;
 	
-	file_close(thread_current()->fdt[fd]);
-	thread_current()->fdt[fd] = NULL;
+	file_close(process_current()->fdt[fd]);
+	process_current()->fdt[fd] = NULL;
 	return;
-}
\ No newline at end of file
+}
+
+int
+sys_getrusage(int who, struct rusage *usage){
+	uint64_t *pml4 = process_current()->pml4;
+	char *end = (char *) (usage + 1) - 1;
+
+	if(!is_user_vaddr(usage) || !is_user_vaddr(end)
+			|| !pml4_get_page(pml4, usage) || !pml4_get_page(pml4, end)) {
+		sys_exit(-1);
+	}
+	if (who == RUSAGE_SELF)
+		thread_get_rusage(usage);
+	else if (who == RUSAGE_CHILDREN) {
+		enum intr_level old_level = intr_disable();
+		*usage = process_current()->child_ru;
+		intr_set_level(old_level);
+	} else
+		return -1;
+	return 0;
+}
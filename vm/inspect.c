@@ -4,12 +4,13 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "userprog/process.h"
 #include "vm/inspect.h"
 
 static void
 inspect (struct intr_frame *f) {
 	const void *va = (const void *) f->R.rax;
-	f->R.rax = PTE_ADDR (pml4_get_page (thread_current ()->pml4, va));
+	f->R.rax = PTE_ADDR (pml4_get_page (thread_current ()->proc->pml4, va));
 }
 
 /* Tool for testing vm component. Calling this function via int 0x42.